@@ -22,4 +22,11 @@ int atomic_cmp_exchange(volatile uint32_t *p, uint32_t cmpval, uint32_t newval);
  * */
 void atomic_store(volatile uint32_t *p, uint32_t val);
 
+/* Atomically adds val to the value stored at p and returns the result.
+ * Pseudocode:
+ * *p += val
+ * return *p
+ * */
+uint32_t atomic_add(volatile uint32_t *p, uint32_t val);
+
 #endif /* __ATOMIC_H__ */
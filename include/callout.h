@@ -43,6 +43,13 @@ void callout_stop(callout_t *handle);
  */
 void callout_process(systime_t now);
 
+/*
+ * Find the time of the earliest pending callout.
+ *
+ * \return False if there are no pending callouts.
+ */
+bool callout_next(systime_t *timep);
+
 /*
  * Wait until a callout ends its execution or return immediately if the
  * callout has already been executed or stopped.
@@ -26,6 +26,13 @@ void intr_enable(void);
 /*! \brief Checks if interrupts are disabled now. */
 bool intr_disabled(void);
 
+/*! \brief Halts processor until an interrupt gets handled.
+ *
+ * Must be called with interrupts disabled once. They're enabled while the
+ * processor waits, and disabled again on return. If an interrupt is pending
+ * already, it's handled and the function returns without halting. */
+void intr_wait(void);
+
 /* Two following functions are workaround to make interrupt disabling work with
  * scoped and with statement. */
 static inline void __intr_disable(void *data) {
@@ -0,0 +1,31 @@
+#ifndef _SYS_KVA_H_
+#define _SYS_KVA_H_
+
+#include <vm.h>
+
+/* Kernel virtual address space allocator. It manages the upper part of KSEG2
+ * and is used to reach physical pages that are not covered by KSEG0. */
+
+/*! \brief Initializes the allocator. Kernel pmap must be set up already. */
+void kva_init(void);
+
+/*! \brief Allocates \a size bytes of unmapped kernel virtual address space.
+ *
+ * \returns NULL if the space is exhausted */
+void *kva_alloc(size_t size);
+
+/*! \brief Returns a range obtained with kva_alloc. */
+void kva_free(void *va, size_t size);
+
+/*! \brief Makes \a pg accessible to the kernel.
+ *
+ * Directly mapped pages are returned at their KSEG0 address, high memory pages
+ * get mapped into freshly allocated range of kernel virtual address space.
+ *
+ * \returns NULL if kernel virtual address space is exhausted */
+void *kva_map_page(vm_page_t *pg);
+
+/*! \brief Undoes kva_map_page. */
+void kva_unmap_page(void *va, vm_page_t *pg);
+
+#endif /* !_SYS_KVA_H_ */
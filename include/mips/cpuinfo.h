@@ -11,6 +11,7 @@ typedef struct cpuinfo {
   int dc_linesize;
   int dc_nways;
   int dc_nsets;
+  int fpu; /* FPU implemented */
 } cpuinfo_t;
 
 extern cpuinfo_t cpuinfo;
@@ -42,6 +42,16 @@ void mips_intr_enable(void);
  */
 bool mips_intr_disabled(void);
 
+/*! \brief Enables interrupts and executes WAIT instruction.
+ *
+ * An interrupt taken after EI but before WAIT makes the handler resume the
+ * code past WAIT, so the processor never halts with the interrupt handled.
+ * Returns with interrupts disabled. */
+void mips_intr_wait(void);
+
+/*! \brief Sets up exception vectors and interrupt mode of this processor. */
+void mips_intr_cpu_init(void);
+
 void mips_intr_init(void);
 void mips_intr_handler(exc_frame_t *frame);
 void mips_intr_setup(intr_handler_t *ih, mips_intr_t irq);
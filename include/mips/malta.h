@@ -62,6 +62,10 @@ void platform_init(int argc, char **argv, char **envp, unsigned memsize);
  */
 
 #define MALTA_PHYS_SDRAM_BASE 0x00000000
+/* Whole SDRAM is also visible here, including memory above 256MiB that does
+ * not fit below PCI memory window. */
+#define MALTA_PHYS_SDRAM_HIGH 0x80000000
+#define MALTA_PHYS_SDRAM_HIGH_MAX 0x7ffff000U
 
 #define MALTA_PCI0_MEMORY_BASE 0x10000000
 #define MALTA_PCI0_MEMORY_END 0x17ffffff
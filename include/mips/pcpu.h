@@ -1,12 +1,22 @@
 #ifndef _MIPS_PCPU_H_
 #define _MIPS_PCPU_H_
 
+#include <mips/pmap.h>
+
+/* Each processor sees its own pcpu structure at this address. */
+#define PCPU_VADDR PMAP_PCPU_BEGIN
+
 #ifdef __ASSEMBLER__
 
 #include <mips/asm.h>
 #include <mips/mips.h>
 
-#define LOAD_PCPU(reg) LA reg, _pcpu_data
+/* Expands to a single instruction, as the address is sign-extended 16-bit. */
+#define LOAD_PCPU(reg) li reg, PCPU_VADDR
+
+#else /* !__ASSEMBLER__ */
+
+#define _pcpu() ((pcpu_t *)PCPU_VADDR)
 
 #endif /* !__ASSEMBLER__ */
 #endif /* !_MIPS_PCPU_H_ */
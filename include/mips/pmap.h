@@ -16,9 +16,28 @@
 
 #define PMAP_KERNEL_BEGIN MIPS_KSEG2_START
 #define PMAP_KERNEL_END 0xffffe000 /* kseg2 & kseg3 */
+#define PMAP_KVA_BEGIN 0xe0000000 /* range managed by KVA allocator */
+#define PMAP_KVA_END PMAP_PCPU_BEGIN
+/* Every processor maps its own pcpu structure at the same address with a wired
+ * TLB entry. It's within reach of 16-bit signed immediate (see LOAD_PCPU). */
+#define PMAP_PCPU_BEGIN 0xffff8000
+/* Kmap window consists of TLB_KMAP_SLOTS pages, each at the beginning of 8KiB
+ * block, as every slot is backed by its own wired TLB entry. */
+#define PMAP_KMAP_BEGIN 0xffffa000
+#define PMAP_KMAP_END PMAP_KERNEL_END
 #define PMAP_USER_BEGIN 0x00400000
 #define PMAP_USER_END 0x80000000
 
+/* Large pages use PTE bits 29..26 (the unused upper part of PFN field) for
+ * software purposes. TLB refill handler strips them before loading EntryLo.
+ * The page size index is encoded as in PageMask, i.e. a large page spans
+ * PAGESIZE * 4^index bytes (16KiB to 16MiB). */
+#define PTE_SW_SHIFT 26
+#define PTE_SW_BITS 4
+#define PTE_PGSZ_SHIFT 26
+#define PTE_PGSZ_BITS 3
+#define PTE_PGSZ_MAX 6
+
 /* Base addresses of active user and kernel page directory tables.
  * UPD_BASE must begin at 8KiB boundary. */
 #define UPD_BASE (PMAP_KERNEL_END + PD_SIZE * 0)
@@ -3,4 +3,7 @@
 
 void mips_timer_init(void);
 
+/*! \brief Starts scheduler clock tick on a secondary processor. */
+void mips_timer_cpu_init(void);
+
 #endif /* !_MIPS_TIMER_H_ */
@@ -9,6 +9,13 @@ typedef uint32_t tlblo_t;
 /* Choose index specified by the Random Register. */
 #define TLBI_RANDOM (-1U)
 
+/* Wired TLB entries. */
+#define TLB_WIRED_PDE 0  /* page directory tables of active pmaps */
+#define TLB_WIRED_PCPU 1 /* private per-cpu structure */
+#define TLB_WIRED_KMAP 2 /* first slot of kmap window */
+#define TLB_KMAP_SLOTS 2
+#define TLB_NWIRED (TLB_WIRED_KMAP + TLB_KMAP_SLOTS)
+
 typedef struct {
   tlbhi_t hi;
   tlblo_t lo0;
@@ -54,9 +61,10 @@ void tlb_init(void);
 void tlb_print(void);
 
 /*
- * Note that MIPS implements variable page size by specifying PageMask register,
- * so intuitively these functions shall specify PageMask. However in current
- * implementation we aren't going to use other page size than 4KiB.
+ * Note that MIPS implements variable page size by specifying PageMask register.
+ * Large page entries are inserted only by TLB refill handler (see ebase.S),
+ * hence all entries written by functions below are 4KiB. Still, probing with
+ * any address covered by a large page entry will find it.
  */
 
 /* Returns the number of entries in the TLB. */
@@ -5,6 +5,12 @@
 
 #define MAP_FAILED ((void *)-1)
 
+/* Memory usage hints accepted by madvise. */
+#define MADV_NORMAL 0     /* no further special treatment */
+#define MADV_SEQUENTIAL 2 /* expect sequential page references */
+#define MADV_WILLNEED 3   /* will need these pages */
+#define MADV_DONTNEED 4   /* don't need these pages */
+
 #ifndef _KERNELSPACE
 
 #define MAP_FILE 0
@@ -21,6 +27,10 @@
 
 /* Newlib does not provide mmap prototype, so we need to use our own. */
 void *mmap(void *addr, size_t length, int prot, int flags);
+int munmap(void *addr, size_t length);
+int mprotect(void *addr, size_t length, int prot);
+int madvise(void *addr, size_t length, int advice);
+int mincore(void *addr, size_t length, char *vec);
 
 #else /* _KERNELSPACE */
 
@@ -28,6 +38,9 @@ void *mmap(void *addr, size_t length, int prot, int flags);
 
 int do_mmap(vaddr_t *addr_p, size_t length, vm_prot_t prot, vm_flags_t flags);
 int do_munmap(vaddr_t addr, size_t length);
+int do_mprotect(vaddr_t addr, size_t length, vm_prot_t prot);
+int do_madvise(vaddr_t addr, size_t length, int advice);
+int do_mincore(vaddr_t addr, size_t length, char *user_vec);
 
 #endif /* !_KERNELSPACE */
 
@@ -1,26 +1,45 @@
 #ifndef _PCPU_H_
 #define _PCPU_H_
 
+#include <common.h>
+#include <vm.h>
+#include <runq.h>
+#include <mips/pcpu.h>
+
+#define MAXCPU 4 /* maximum number of processors supported */
+
 typedef struct thread thread_t;
 typedef struct pmap pmap_t;
 typedef struct vm_map vm_map_t;
 
-/*! \brief Private per-cpu structure. */
+/*! \brief Private per-cpu structure.
+ *
+ * Each instance occupies a whole page, which gets mapped by a wired TLB entry
+ * at the same virtual address on every processor (see \a PCPU_VADDR). */
 typedef struct pcpu {
   thread_t *curthread;   /*!< thread running on this CPU */
   thread_t *idle_thread; /*!< idle thread executed on this CPU */
   pmap_t *curpmap;       /*!< current page table */
   vm_map_t *uspace;      /*!< user space virtual memory map */
   void *ksp;             /*!< (MIPS) sp restored on user->kernel transition */
-} pcpu_t;
+  unsigned kmap_used;    /*!< (MIPS) bitmap of busy kmap window slots */
+  unsigned cpuid;        /*!< number of this CPU */
+  bool running;          /*!< CPU has been started */
+  volatile unsigned ipi; /*!< bitmap of pending inter-processor interrupts */
+  runq_t runq;           /*!< threads ready to run on this CPU */
+} __aligned(PAGESIZE) pcpu_t;
 
-extern pcpu_t _pcpu_data[1];
+extern pcpu_t _pcpu_data[MAXCPU];
 
 /* Read pcpu.h from FreeBSD for API reference */
-#define PCPU_GET(member) (_pcpu_data->member)
-#define PCPU_PTR(member) (&_pcpu_data->member)
-#define PCPU_SET(member, value) (_pcpu_data->member = (value))
+#define PCPU_GET(member) (_pcpu()->member)
+#define PCPU_PTR(member) (&_pcpu()->member)
+#define PCPU_SET(member, value) (_pcpu()->member = (value))
+
+/*! \brief Makes \a _pcpu_data[cpuid] the pcpu structure of this processor. */
+void pcpu_init(unsigned cpuid);
 
-void pcpu_init(void);
+/*! \brief Machine dependent part of \a pcpu_init. */
+void pcpu_md_init(pcpu_t *pc);
 
 #endif /* _PCPU_H_ */
@@ -27,10 +27,21 @@ void pm_seg_reserve(pm_seg_t *seg, paddr_t start, paddr_t end);
 /* Add physical memory segment to physical memory manager. */
 void pm_add_segment(pm_seg_t *seg);
 
-/* Allocates contiguous big page that consists of n machine pages. */
+/* Allocates contiguous big page that consists of n machine pages. The page is
+ * always directly accessible with PG_KSEG0_ADDR. */
 vm_page_t *pm_alloc(size_t n);
+/* Like pm_alloc, but prefers pages from segments not covered by KSEG0, that
+ * have to be mapped into kernel virtual address space before use. Falls back to
+ * directly mapped pages when high memory runs out. */
+vm_page_t *pm_alloc_high(size_t n);
 
 void pm_free(vm_page_t *page);
+/* Frees all pages linked on @pages list with pageq field. Pages are sorted by
+ * physical address first, so that contiguous runs are returned to buddy system
+ * as large blocks. Much cheaper than calling pm_free for each page. */
+void pm_free_list(pg_list_t *pages);
+/* Returns descriptor of page containing physical address @pa. */
+vm_page_t *pm_find_page(paddr_t pa);
 void pm_dump(void);
 vm_page_t *pm_split_alloc_page(vm_page_t *pg);
 
@@ -15,10 +15,20 @@ typedef struct pmap {
   vm_page_t *pde_page; /* pointer to a page with directory page table */
   pg_list_t pte_pages; /* pages we allocate in page table */
   vaddr_t start, end;
-  asid_t asid;
+  asid_t asid;        /* valid only if asid_gen matches current generation */
+  uint32_t asid_gen; /* ASID generation this pmap's ASID belongs to */
+  vaddr_t inval_start; /* range of TLB entries to be dropped by pmap_update */
+  vaddr_t inval_end;
   mtx_t mtx;
 } pmap_t;
 
+typedef struct pmap_stats {
+  unsigned pt_cache_hits;   /* page tables taken ready from the cache */
+  unsigned pt_cache_misses; /* page tables initialized on demand */
+  unsigned pt_cache_ready;  /* cached page tables ready for use */
+  unsigned pt_cache_dirty;  /* cached page tables awaiting initialization */
+} pmap_stats_t;
+
 void pmap_init(void);
 
 pmap_t *pmap_new(void);
@@ -32,6 +42,35 @@ void pmap_remove(pmap_t *pmap, vaddr_t start, vaddr_t end);
 void pmap_zero_page(vm_page_t *pg);
 void pmap_copy_page(vm_page_t *src, vm_page_t *dst);
 
+/*! \brief Temporarily maps first page of \a pg into kernel address space.
+ *
+ * Works for any physical page, including ones that are not directly mapped.
+ * Preemption is disabled until the mapping is released with pmap_kunmap, so
+ * the caller must not sleep in between. */
+void *pmap_kmap(vm_page_t *pg);
+void pmap_kunmap(void *va);
+
+/*! \brief Does background work, like preparing page tables in advance.
+ *
+ * Called by idle thread, must not sleep.
+ *
+ * \returns false if there was nothing to do */
+bool pmap_idle(void);
+
+/*! \brief Returns cached page tables to physical memory allocator.
+ *
+ * \returns number of pages released */
+size_t pmap_reclaim(void);
+
+/*! \brief Reports page table cache statistics. */
+void pmap_stats(pmap_stats_t *stats);
+
+/*! \brief Handles IPI_TLB_SHOOTDOWN posted by another processor. */
+void pmap_tlb_shootdown_ipi(void);
+
+/*! \brief Handles IPI_TLB_FLUSH posted by another processor. */
+void pmap_tlb_flush_ipi(void);
+
 void pmap_activate(pmap_t *pmap);
 pmap_t *get_kernel_pmap(void);
 pmap_t *get_user_pmap(void);
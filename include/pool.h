@@ -8,7 +8,8 @@ typedef struct pool pool_t;
 
 void pool_bootstrap(void);
 
-#define PF_ZERO 1 /* clear allocated block */
+#define PF_ZERO 1   /* clear allocated block */
+#define PF_NOWAIT 2 /* may return NULL if pool cannot grow */
 
 pool_t *pool_create(const char *desc, size_t size);
 void pool_destroy(pool_t *pool);
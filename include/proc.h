@@ -7,6 +7,7 @@
 #include <condvar.h>
 #include <signal.h>
 #include <vm_map.h>
+#include <resource.h>
 
 typedef struct thread thread_t;
 typedef struct proc proc_t;
@@ -19,6 +20,7 @@ typedef enum { PS_NORMAL, PS_DYING, PS_ZOMBIE } proc_state_t;
  *
  * Field markings and the corresponding locks:
  *  - a: all_proc_mtx
+ *  - h: pidhash_lock
  *  - !: proc_t::p_mtx
  *  - @: read-only access
  *  - ~: always safe to access
@@ -28,6 +30,7 @@ struct proc {
   TAILQ_ENTRY(proc) p_all;    /* (a) link on all processes list */
   TAILQ_ENTRY(proc) p_zombie; /* (a) link on zombie process list */
   TAILQ_ENTRY(proc) p_child;  /* (a) link on parent's children list */
+  LIST_ENTRY(proc) p_hash;    /* (h) link on PID hash chain */
   thread_t *p_thread; /* (!) thread running in this process (only one!) */
   pid_t p_pid;        /* (@) Process ID */
   volatile proc_state_t p_state;  /* (!) process state */
@@ -41,7 +44,9 @@ struct proc {
   /* program segments */
   vm_segment_t *p_sbrk; /* The entry where brk segment resides in. */
   vaddr_t p_sbrk_end;   /* Current end of brk segment. */
-  /* XXX: process resource usage stats */
+  /* process resource usage stats */
+  unsigned p_minflt; /* (!) number of page faults taken */
+  struct rlimit p_rlimit[RLIM_NLIMITS]; /* (!) resource limits */
 };
 
 proc_t *proc_self(void);
@@ -58,4 +63,14 @@ proc_t *proc_find(pid_t pid);
  * \note Exit status shoud be created using MAKE_STATUS macros from wait.h */
 noreturn void proc_exit(int exitstatus);
 
+/*! \brief Fills in resource usage statistics of process \a p. */
+int proc_getrusage(proc_t *p, int who, struct rusage *ru);
+
+/*! \brief Reads limit of \a resource for process \a p. */
+int proc_getrlimit(proc_t *p, int resource, struct rlimit *rlp);
+
+/*! \brief Changes limit of \a resource for process \a p.
+ * Hard limit can only be lowered. */
+int proc_setrlimit(proc_t *p, int resource, const struct rlimit *rlp);
+
 #endif /* !_SYS_PROC_H_ */
@@ -0,0 +1,45 @@
+#ifndef _SYS_RESOURCE_H_
+#define _SYS_RESOURCE_H_
+
+#ifndef _KERNELSPACE
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
+
+#define RUSAGE_SELF 0
+#define RUSAGE_CHILDREN -1
+
+typedef unsigned long rlim_t;
+
+#define RLIM_INFINITY (~(rlim_t)0)
+
+/* Resource limits. Only stack size limit is enforced at the moment. */
+#define RLIMIT_CPU 0   /* cpu time in seconds */
+#define RLIMIT_FSIZE 1 /* maximum file size */
+#define RLIMIT_DATA 2  /* data size */
+#define RLIMIT_STACK 3 /* stack size */
+
+#define RLIM_NLIMITS 4 /* number of resource limits */
+
+struct rlimit {
+  rlim_t rlim_cur; /* current (soft) limit */
+  rlim_t rlim_max; /* maximum value for rlim_cur */
+};
+
+/* User and system time are not accounted separately, so the whole time spent
+ * running is reported in ru_utime. */
+struct rusage {
+  struct timeval ru_utime; /* user time used */
+  struct timeval ru_stime; /* system time used */
+  long ru_minflt;          /* page faults not requiring I/O */
+  long ru_majflt;          /* page faults requiring I/O */
+};
+
+#ifndef _KERNELSPACE
+int getrusage(int who, struct rusage *usage);
+int getrlimit(int resource, struct rlimit *rlp);
+int setrlimit(int resource, const struct rlimit *rlp);
+#endif /* !_KERNELSPACE */
+
+#endif /* !_SYS_RESOURCE_H_ */
@@ -11,7 +11,14 @@ typedef struct thread thread_t;
 
 TAILQ_HEAD(rq_head, thread);
 
-typedef struct { struct rq_head rq_queues[RQ_NQS]; } runq_t;
+#define RQB_BPW 32                 /* Bits in a status word. */
+#define RQB_LEN (RQ_NQS / RQB_BPW) /* Number of status words. */
+
+typedef struct {
+  uint32_t rq_status[RQB_LEN]; /* bit set for each non-empty queue */
+  unsigned rq_count;           /* number of threads on all queues */
+  struct rq_head rq_queues[RQ_NQS];
+} runq_t;
 
 /* Initialize a run structure. */
 void runq_init(runq_t *);
@@ -19,10 +26,16 @@ void runq_init(runq_t *);
 /* Add the thread to the queue specified by its priority */
 void runq_add(runq_t *, thread_t *);
 
+/* Same as runq_add, but put the thread in front of others of equal priority. */
+void runq_add_head(runq_t *, thread_t *);
+
 /* Find the highest priority process on the run queue. */
 thread_t *runq_choose(runq_t *);
 
 /* Remove the thread from the queue specified by its priority. */
 void runq_remove(runq_t *, thread_t *);
 
+/* Check if there are no threads on the queue. Safe to call without locks. */
+bool runq_empty(runq_t *);
+
 #endif
@@ -36,6 +36,51 @@ static inline void __preempt_enable(void *data) {
 #define WITH_NO_PREEMPTION                                                     \
   WITH_STMT(void, __preempt_disable, __preempt_enable, NULL)
 
+/* Scheduling policies, numbered as in POSIX. */
+#define SCHED_OTHER 0 /* time-sharing, priority follows interactivity */
+#define SCHED_FIFO 1  /* real-time, runs until it blocks or gets preempted */
+#define SCHED_RR 2    /* real-time, time sliced among equal priorities */
+
+/* Time-sharing threads of user processes have priorities from 0 up to
+ * PRIO_USER_MAX, interactivity bonus included. Time-sharing kernel threads
+ * start at PRIO_KTHREAD, so that no user thread can get ahead of them. */
+#define PRIO_USER_MAX 63
+#define PRIO_KTHREAD 64
+
+/* Real-time threads have priorities above all time-sharing ones. Priorities
+ * above PRIO_RT_USER_MAX are reserved for kernel threads, so that user
+ * processes cannot starve them. */
+#define PRIO_RT_MIN 128
+#define PRIO_RT_USER_MAX 191
+#define PRIO_RT_MAX 255
+#define PRIO_TS_MAX (PRIO_RT_MIN - 1)
+
+/* Layout as in POSIX. Real-time policies take priority from 0 up to
+ * PRIO_RT_MAX - PRIO_RT_MIN (PRIO_RT_USER_MAX - PRIO_RT_MIN for user
+ * processes), time-sharing one takes 0 only. */
+struct sched_param {
+  int sched_priority;
+};
+
+typedef struct sched_stats {
+  unsigned migrations; /* threads woken up on other processor than last time */
+  unsigned steals;     /* threads taken over by idle processors */
+} sched_stats_t;
+
+/* Wakeup-to-run latencies are collected separately for SCHED_LAT_BANDS equal
+ * bands of consecutive priorities. Bucket i of a histogram counts values that
+ * have i significant bits, the last one counts the rest. */
+#define SCHED_LAT_BANDS 8
+#define SCHED_LAT_BUCKETS 24  /* latency in microseconds */
+#define SCHED_DEPTH_BUCKETS 8 /* run queue length */
+
+typedef struct sched_lat_band {
+  unsigned count;       /* number of threads dispatched after wakeup */
+  unsigned max_latency; /* longest latency in microseconds */
+  unsigned latency[SCHED_LAT_BUCKETS];
+  unsigned depth[SCHED_DEPTH_BUCKETS]; /* threads on run queue at dispatch */
+} sched_lat_band_t;
+
 /*! \brief Add new thread to the scheduler.
  *
  * The thread will be set runnable. */
@@ -76,6 +121,16 @@ void sched_unlend_prio(thread_t *td, prio_t prio);
  */
 void sched_set_prio(thread_t *td, prio_t prio);
 
+/*! \brief Set scheduling policy of a thread and its base priority.
+ *
+ * \param priority is relative to the range of given policy
+ * \returns 0 on success, -EINVAL if policy or priority is invalid
+ */
+int sched_setscheduler(thread_t *td, int policy, int priority);
+
+/*! \brief Returns scheduling policy of a thread. */
+int sched_getscheduler(thread_t *td);
+
 /*! \brief Takes care of run-time accounting for current thread.
  *
  * \note Must be called from interrupt context.
@@ -101,6 +156,15 @@ long sched_switch(void);
  */
 void sched_maybe_preempt(void);
 
+/*! \brief Fetches counters of thread moves between processors. */
+void sched_stats(sched_stats_t *stats);
+
+/*! \brief Copies latency histograms of all priority bands to \a bands. */
+void sched_lat_get(sched_lat_band_t bands[SCHED_LAT_BANDS]);
+
+/*! \brief Clears latency histograms. */
+void sched_lat_reset(void);
+
 /*! \brief Turns calling thread into idle thread. */
 noreturn void sched_run(void);
 
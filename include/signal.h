@@ -56,14 +56,16 @@ typedef struct proc proc_t;
 
 typedef bitstr_t sigset_t[bitstr_size(NSIG)];
 
-/* Sends a signal to a process. */
-int sig_send(proc_t *td, signo_t sig);
+/* Sends a signal to a process. Must be called with p_lock of the process held. */
+int sig_send(proc_t *proc, signo_t sig);
 
 /* Process signals pending for the thread. If the thread has received a signal
-   that should be caught by the user, return the signal number. */
+   that should be caught by the user, return the signal number. Must be called
+   with p_lock of the thread's process and td_lock held. */
 int sig_check(thread_t *td);
 
-/* Process user action triggered by a signal. */
+/* Process user action triggered by a signal. Must be called with p_lock of the
+   current process held. */
 void sig_deliver(signo_t sig);
 
 /* Arrange for signal delivery when the thread returns from exception context.
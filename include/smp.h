@@ -0,0 +1,60 @@
+#ifndef _SYS_SMP_H_
+#define _SYS_SMP_H_
+
+#include <common.h>
+
+/*! \file smp.h
+ *
+ * Kernel code is executed by one processor at a time -- the one that holds
+ * the big kernel lock (BKL). A processor acquires it when it enters the kernel
+ * from user space and releases it when it returns there, or when its idle
+ * thread waits for work. Hence synchronization primitives, which are designed
+ * with single processor in mind, remain valid, while user programs run on all
+ * processors in parallel.
+ */
+
+/*! \brief Number of running processors. */
+extern unsigned ncpus;
+
+/* Inter-processor interrupts. */
+#define IPI_TLB_SHOOTDOWN 0x1 /* see pmap_tlb_shootdown_ipi */
+#define IPI_TLB_FLUSH 0x2     /* see pmap_tlb_flush_ipi */
+
+typedef struct pcpu pcpu_t;
+
+/*! \brief Starts secondary processors (machine dependent).
+ *
+ * They enter the kernel once the boot processor releases BKL. */
+void smp_start(void);
+
+/*! \brief Acquires the big kernel lock.
+ *
+ * While waiting for the lock, and once it's taken, the processor handles IPIs
+ * posted to it. */
+void bkl_acquire(void);
+
+/*! \brief Releases the big kernel lock. */
+void bkl_release(void);
+
+/*! \brief Check if this processor holds the big kernel lock. */
+bool bkl_owned(void);
+
+/*! \brief Posts \a ipi to another processor.
+ *
+ * There is no way to interrupt another processor on Malta, so IPIs are handled
+ * when the processor enters the kernel. A processor running user code does so
+ * on next clock tick at the latest, while an idle one may not do it until
+ * it gets some work.
+ *
+ * \note Caller must hold the big kernel lock. */
+void ipi_post(pcpu_t *pc, unsigned ipi);
+
+/*! \brief Waits until processor \a pc handles \a ipi posted to it.
+ *
+ * \note Caller must hold the big kernel lock. */
+void ipi_wait(pcpu_t *pc, unsigned ipi);
+
+/*! \brief Handles IPIs posted to this processor. */
+void ipi_poll(void);
+
+#endif /* !_SYS_SMP_H_ */
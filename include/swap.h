@@ -0,0 +1,71 @@
+#ifndef _SYS_SWAP_H_
+#define _SYS_SWAP_H_
+
+#include <vm.h>
+
+/* Pages of anonymous objects can be moved out to a backing store, when
+ * physical memory runs out. Backing store is divided into page sized slots.
+ * Each object keeps track of slots holding its paged out pages. */
+
+typedef int swslot_t;
+
+#define SWAP_NOSLOT (-1)
+
+typedef struct swap_dev swap_dev_t;
+
+typedef void swap_read_t(swap_dev_t *sd, swslot_t slot, void *buf);
+typedef void swap_write_t(swap_dev_t *sd, swslot_t slot, const void *buf);
+
+struct swap_dev {
+  const char *sd_name;
+  size_t sd_nslots;       /* size of backing store in pages */
+  swap_read_t *sd_read;   /* fetch contents of a slot into buffer */
+  swap_write_t *sd_write; /* store contents of buffer into a slot */
+  void *sd_data;          /* backend specific data */
+};
+
+/*! \brief Makes \a sd the backing store. Only one device is supported. */
+void swap_attach(swap_dev_t *sd);
+
+/*! \brief Uses [start, start + size) physical memory range as backing store.
+ *
+ * The range must not be managed by physical memory allocator. */
+void swap_ram_attach(paddr_t start, size_t size);
+
+/*! \brief Number of free slots in backing store. */
+size_t swap_available(void);
+
+/*! \brief Writes out page \a pg of object \a obj and releases it.
+ *
+ * The caller must have removed all mappings of the page beforehand.
+ * \returns false if there is no backing store, it is full or there is no
+ * memory left to record the slot */
+bool swap_pageout(vm_object_t *obj, vm_page_t *pg);
+
+/*! \brief Reads page at \a offset of \a obj from backing store into \a pg.
+ *
+ * The slot is released, the page is not inserted into the object.
+ * \returns false if the page was not paged out */
+bool swap_pagein(vm_object_t *obj, off_t offset, vm_page_t *pg);
+
+/*! \brief Checks if page at \a offset of \a obj resides in backing store. */
+bool swap_has_page(vm_object_t *obj, off_t offset);
+
+/*! \brief Checks if no page of [start, end) range resides in backing store. */
+bool swap_range_empty(vm_object_t *obj, off_t start, off_t end);
+
+/*! \brief Releases slots of pages within [start, end) offset range. */
+void swap_free_range(vm_object_t *obj, off_t start, off_t end);
+
+/*! \brief Releases all slots of the object. */
+void swap_free_object(vm_object_t *obj);
+
+/*! \brief Hands over slots at and above \a offset to \a new_obj.
+ *
+ * Offsets are rebased to begin at 0 in the new object. */
+void swap_split(vm_object_t *obj, vm_object_t *new_obj, off_t offset);
+
+/*! \brief Copies paged out contents of \a obj into \a new_obj. */
+void swap_clone(vm_object_t *obj, vm_object_t *new_obj);
+
+#endif /* !_SYS_SWAP_H_ */
@@ -25,7 +25,16 @@
 #define SYS_RMDIR 22
 #define SYS_ACCESS 23
 #define SYS_STAT 24
-#define SYS_LAST 25
+#define SYS_MUNMAP 25
+#define SYS_MPROTECT 26
+#define SYS_MADVISE 27
+#define SYS_MINCORE 28
+#define SYS_GETRUSAGE 29
+#define SYS_GETRLIMIT 30
+#define SYS_SETRLIMIT 31
+#define SYS_SCHED_SETSCHEDULER 32
+#define SYS_SCHED_GETSCHEDULER 33
+#define SYS_LAST 34
 
 #ifndef __ASSEMBLER__
 
@@ -72,6 +72,7 @@ typedef enum {
  *
  * Locking order:
  *  threads_lock >> thread_t::td_lock
+ *  proc_t::p_lock >> thread_t::td_lock
  */
 typedef struct thread {
   /* locks */
@@ -84,9 +85,10 @@ typedef struct thread {
   TAILQ_ENTRY(thread) td_sleepq;   /* a link on sleep queue */
   TAILQ_ENTRY(thread) td_blockedq; /* (#) a link on turnstile blocked queue */
   TAILQ_ENTRY(thread) td_zombieq;  /* a link on zombie queue */
+  LIST_ENTRY(thread) td_hash;      /* a link on TID hash chain */
   /* Properties */
   proc_t *td_proc; /*!< (t) parent process (NULL for kernel threads) */
-  char *td_name;   /*!< (@) name of thread */
+  char td_name[TD_NAME_MAX]; /*!< (@) name of thread */
   tid_t td_tid;    /*!< (@) thread identifier */
   /* thread state */
   thread_state_t td_state;    /*!< (!) thread state */
@@ -112,12 +114,18 @@ typedef struct thread {
   /* scheduler part */
   prio_t td_base_prio; /*!< base priority */
   prio_t td_prio;      /*!< active priority */
+  int td_policy;       /*!< (!) scheduling policy, one of SCHED_* */
   int td_slice;
+  unsigned td_runhist; /*!< (!) recent running time in microseconds */
+  unsigned td_slphist; /*!< (!) recent sleeping time in microseconds */
+  unsigned td_cpu;     /*!< (!) CPU of run queue holding thread or last CPU */
   /* thread statistics */
-  timeval_t td_rtime;        /*!< time spent running */
-  timeval_t td_last_rtime;   /*!< time of last switch to running state */
-  timeval_t td_slptime;      /*!< time spent sleeping */
-  timeval_t td_last_slptime; /*!< time of last switch to sleep state */
+  /* all in processor cycles, see getcputicks */
+  cputicks_t td_rtime;        /*!< time spent running */
+  cputicks_t td_last_rtime;   /*!< time of last switch to running state */
+  cputicks_t td_slptime;      /*!< time spent sleeping */
+  cputicks_t td_last_slptime; /*!< time of last switch to sleep state */
+  cputicks_t td_last_wkptime; /*!< (!) time of wakeup, cleared once running */
   unsigned td_nctxsw;        /*!< total number of context switches */
   /* signal handling */
   sigset_t td_sigpend; /* Pending signals for this thread. */
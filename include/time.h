@@ -125,8 +125,26 @@ bintime_t getbintime(void);
  * and is maintained by system clock. */
 systime_t getsystime(void);
 
+/* Stops system clock and sets up a timer to trigger at the earliest callout.
+ * Called by idle thread, with interrupts disabled, before it waits. */
+void clock_idle_enter(void);
+
+/* Restarts system clock and processes callouts that expired meanwhile. */
+void clock_idle_leave(void);
+
 /* XXX: Do not use this function, it'll get removed.
  * Raw access to cpu internal timer. */
 timeval_t getcputime(void);
 
+/* Processor cycle counter extended to 64 bits. Reading it is much cheaper than
+ * getbintime, hence it's used for accounting on hot paths. Values read on
+ * different processors are comparable. */
+typedef uint64_t cputicks_t;
+
+cputicks_t getcputicks(void);
+
+/* Converts processor cycles to time. Conversion to microseconds saturates. */
+timeval_t cputicks2tv(cputicks_t ticks);
+unsigned cputicks2us(cputicks_t ticks);
+
 #endif /* !_SYS_TIME_H_ */
@@ -7,13 +7,14 @@
 
 #include <common.h>
 #include <queue.h>
-#include <tree.h>
 #include <mips/mips.h>
 
 #define PG_SIZE(pg) ((pg)->size * PAGESIZE)
 #define PG_START(pg) ((pg)->paddr)
 #define PG_END(pg) ((pg)->paddr + PG_SIZE(pg))
 #define PG_KSEG0_ADDR(pg) (void *)(MIPS_PHYS_TO_KSEG0((pg)->paddr))
+/* Page lies beyond the reach of KSEG0 and must be mapped to be accessed. */
+#define PG_HIGHMEM(pg) ((pg)->paddr > MIPS_PHYS_MASK)
 
 #define is_page_aligned(addr) is_aligned((addr), PAGESIZE)
 
@@ -23,6 +24,7 @@
 
 #define VM_ACCESSED 1 /* page has been accessed since last check */
 #define VM_MODIFIED 2 /* page has been modified since last check */
+#define VM_ORPHAN 4   /* page left its object while held, free on release */
 
 typedef enum {
   VM_PROT_NONE = 0,
@@ -43,8 +45,6 @@ typedef enum {
 typedef struct vm_page vm_page_t;
 TAILQ_HEAD(pg_list, vm_page);
 typedef struct pg_list pg_list_t;
-RB_HEAD(pg_tree, vm_page);
-typedef struct pg_tree pg_tree_t;
 
 typedef struct vm_map vm_map_t;
 typedef struct vm_segment vm_segment_t;
@@ -55,16 +55,16 @@ struct vm_page {
   union {
     TAILQ_ENTRY(vm_page) freeq; /* list of free pages for buddy system */
     TAILQ_ENTRY(vm_page) pageq; /* used to group allocated pages */
-    struct {
-      TAILQ_ENTRY(vm_page) list;
-      RB_ENTRY(vm_page) tree;
-    } obj;
   };
   vm_object_t *object; /* object owning that page */
-  off_t offset;        /* offset to page in vm_object */
+  union {
+    off_t offset;    /* offset to page in vm_object */
+    unsigned nptes;  /* number of live entries if page holds a page table */
+  };
   paddr_t paddr;       /* physical address of page */
   uint8_t vm_flags;    /* flags used by virtual memory system */
   uint8_t pm_flags;    /* flags used by physical memory system */
+  uint16_t hold_count; /* page must not be released while nonzero */
   uint32_t size;       /* size of page in PAGESIZE units */
 };
 
@@ -21,7 +21,29 @@ void vm_segment_free(vm_segment_t *seg);
 
 vm_segment_t *vm_map_find_segment(vm_map_t *vm_map, vaddr_t vaddr);
 
-void vm_map_protect(vm_map_t *map, vaddr_t start, vaddr_t end, vm_prot_t prot);
+/*! \brief Changes protection of [start, end) range to \a prot.
+ *
+ * Segments crossing range boundaries are split. */
+int vm_map_protect(vm_map_t *map, vaddr_t start, vaddr_t end, vm_prot_t prot);
+
+/*! \brief Removes all mappings from [start, end) range.
+ *
+ * Segments crossing range boundaries are split, pages backing the range are
+ * returned to physical memory allocator. */
+int vm_map_remove(vm_map_t *map, vaddr_t start, vaddr_t end);
+
+/*! \brief Applies usage hint \a advice (one of MADV_*) to [start, end) range.
+ *
+ * MADV_DONTNEED releases pages backing the range, but leaves mappings intact.
+ * MADV_WILLNEED brings in nonresident pages of the range in one pass.
+ * MADV_SEQUENTIAL turns on fault-around for segments within the range. */
+int vm_map_advise(vm_map_t *map, vaddr_t start, vaddr_t end, int advice);
+
+/*! \brief Reports which pages of [start, end) range are resident.
+ *
+ * Sets an entry of \a vec to 1 for each resident page, to 0 otherwise.
+ * \returns -ENOMEM if the range is not fully mapped */
+int vm_map_resident(vm_map_t *map, vaddr_t start, vaddr_t end, uint8_t *vec);
 
 /*! \brief Insert given \a segment into the \a map. */
 int vm_map_insert(vm_map_t *map, vm_segment_t *segment, vm_flags_t flags);
@@ -45,13 +67,32 @@ void vm_segment_range(vm_segment_t *seg, vaddr_t *start_p, vaddr_t *end_p);
 int vm_map_findspace(vm_map_t *map, vaddr_t /*inout*/ *start_p, size_t length);
 
 /* Tries to resize an segment, by moving its end if there
-   are no other mappings in the way. On success, returns 0. */
+   are no other mappings in the way. Shrinking releases pages beyond new end.
+   On success, returns 0. */
 int vm_map_resize(vm_map_t *map, vm_segment_t *seg, vaddr_t new_end);
 
 void vm_map_dump(vm_map_t *vm_map);
 
 vm_map_t *vm_map_clone(vm_map_t *map);
 
+/*! \brief Moves out up to \a npages pages of anonymous memory to swap.
+ *
+ * User address spaces are visited in round robin fashion.
+ * \returns number of pages released */
+size_t vm_map_pageout(size_t npages);
+
 int vm_page_fault(vm_map_t *map, vaddr_t fault_addr, vm_prot_t fault_type);
 
+/*! \brief Finds page backing address \a vaddr of \a map.
+ *
+ * Nonresident page is brought in as if \a access caused a page fault, so the
+ * map need not be active. The page is returned held, so it cannot be paged
+ * out or released until passed to vm_map_release_page.
+ * \returns 0 and sets *pgp on success, negative error code otherwise */
+int vm_map_lookup_page(vm_map_t *map, vaddr_t vaddr, vm_prot_t access,
+                       vm_page_t **pgp);
+
+/*! \brief Drops the hold taken on \a pg by vm_map_lookup_page. */
+void vm_map_release_page(vm_map_t *map, vm_page_t *pg);
+
 #endif /* !_SYS_VM_MAP_H_ */
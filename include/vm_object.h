@@ -2,14 +2,14 @@
 #define _SYS_VM_OBJECT_H_
 
 #include <queue.h>
-#include <tree.h>
 #include <vm.h>
+#include <vm_radix.h>
 #include <vm_pager.h>
 
 /* At the moment assume object is owned by only one vm_map */
 typedef struct vm_object {
-  pg_list_t list;
-  pg_tree_t tree;
+  vm_radix_t pages;                   /* resident pages by page index */
+  TAILQ_HEAD(swblk_list, swblk) swap; /* slots of paged out pages */
   size_t size;
   size_t npages;
   vm_pager_t *pager;
@@ -17,10 +17,34 @@ typedef struct vm_object {
 
 vm_object_t *vm_object_alloc(vm_pgr_type_t type);
 void vm_object_free(vm_object_t *obj);
+/*! \brief Frees the object, but hands over its pages to the caller.
+ *
+ * Pages are appended to \a pages list, so that they can be released in bulk
+ * with pm_free_list. */
+void vm_object_destroy(vm_object_t *obj, pg_list_t *pages);
 bool vm_object_add_page(vm_object_t *obj, off_t offset, vm_page_t *pg);
 void vm_object_remove_page(vm_object_t *obj, vm_page_t *pg);
 vm_page_t *vm_object_find_page(vm_object_t *obj, off_t offset);
+/*! \brief Finds resident page with the smallest offset not less than given. */
+vm_page_t *vm_object_next_page(vm_object_t *obj, off_t offset);
+/*! \brief Frees all pages within [start, end) offset range. */
+void vm_object_remove_range(vm_object_t *obj, off_t start, off_t end);
+/*! \brief Moves pages at and above \a offset into a new object.
+ *
+ * Offsets of moved pages are rebased to begin at 0 in the new object. */
+vm_object_t *vm_object_split(vm_object_t *obj, off_t offset);
+/*! \brief Checks if there are no pages within [start, end) offset range.
+ *
+ * Pages moved out to swap space count as present. */
+bool vm_object_range_empty(vm_object_t *obj, off_t start, off_t end);
 vm_object_t *vm_object_clone(vm_object_t *obj);
+/*! \brief Prevents the page from being released.
+ *
+ * A held page that gets removed from its object is freed by the last
+ * vm_page_unhold. Pageout skips held pages. */
+void vm_page_hold(vm_page_t *pg);
+/*! \brief Drops a hold acquired with vm_page_hold. */
+void vm_page_unhold(vm_page_t *pg);
 void vm_map_object_dump(vm_object_t *obj);
 
 #endif /* !_SYS_VM_OBJECT_H_ */
@@ -0,0 +1,47 @@
+#ifndef _SYS_VM_RADIX_H_
+#define _SYS_VM_RADIX_H_
+
+#include <common.h>
+#include <vm.h>
+
+/* Radix trie that maps page indices (i.e. offset / PAGESIZE) to pages. Each
+ * node resolves VM_RADIX_SHIFT bits of the index. The trie is only as tall as
+ * the largest index stored in it requires, so objects with few pages at low
+ * offsets are looked up in one or two steps. */
+
+#define VM_RADIX_SHIFT 4
+#define VM_RADIX_SLOTS (1 << VM_RADIX_SHIFT)
+#define VM_RADIX_MASK (VM_RADIX_SLOTS - 1)
+#define VM_RADIX_MAXHEIGHT                                                     \
+  ((sizeof(vm_pindex_t) * 8 + VM_RADIX_SHIFT - 1) / VM_RADIX_SHIFT)
+
+typedef uint32_t vm_pindex_t;
+typedef struct vm_radix_node vm_radix_node_t;
+
+typedef struct vm_radix {
+  vm_radix_node_t *root;
+  unsigned height; /* number of levels, 0 if trie has no nodes */
+} vm_radix_t;
+
+#define OFF_TO_IDX(off) ((vm_pindex_t)((off) / PAGESIZE))
+#define IDX_TO_OFF(idx) ((off_t)(idx)*PAGESIZE)
+
+void vm_radix_init(vm_radix_t *rt);
+/*! \brief Inserts a page at given index.
+ *
+ * \returns false if the index is already occupied */
+bool vm_radix_insert(vm_radix_t *rt, vm_pindex_t idx, vm_page_t *pg);
+/*! \brief Removes a page at given index and releases emptied nodes.
+ *
+ * \returns removed page or NULL if there was none */
+vm_page_t *vm_radix_remove(vm_radix_t *rt, vm_pindex_t idx);
+vm_page_t *vm_radix_lookup(vm_radix_t *rt, vm_pindex_t idx);
+/*! \brief Finds a page with the smallest index not less than \a idx. */
+vm_page_t *vm_radix_lookup_ge(vm_radix_t *rt, vm_pindex_t idx);
+/*! \brief Empties the trie in one sweep.
+ *
+ * Pages are appended to \a pages list (linked with pageq field) in index
+ * order, all nodes are released. */
+void vm_radix_drain(vm_radix_t *rt, pg_list_t *pages);
+
+#endif /* !_SYS_VM_RADIX_H_ */
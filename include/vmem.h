@@ -0,0 +1,68 @@
+#ifndef _SYS_VMEM_H_
+#define _SYS_VMEM_H_
+
+#include <common.h>
+#include <queue.h>
+#include <mutex.h>
+
+/* General purpose resource allocator for integer ranges, modeled after
+ * vmem(9). Ranges are kept as boundary tags in address order, free ones are
+ * additionally put into power-of-two sized free lists, so that a fitting
+ * range is found in constant time. Small allocations are served by quantum
+ * caches, which hold ranges of a fixed size ready to be handed out. */
+
+typedef uintptr_t vmem_addr_t;
+typedef size_t vmem_size_t;
+
+#define VMEM_MAXORDER 32
+#define VMEM_HASHSIZE 64
+#define VMEM_QCACHE_MAX 8U  /* maximum number of quantum caches */
+#define VMEM_QCACHE_SIZE 16 /* ranges held by a single quantum cache */
+
+typedef struct bt bt_t;
+typedef TAILQ_HEAD(bt_seglist, bt) bt_seglist_t;
+typedef LIST_HEAD(, bt) bt_list_t;
+
+typedef struct vmem_qcache {
+  unsigned qc_count;
+  vmem_addr_t qc_items[VMEM_QCACHE_SIZE];
+} vmem_qcache_t;
+
+typedef struct vmem {
+  mtx_t vm_lock;
+  const char *vm_name;
+  vmem_size_t vm_quantum;
+  unsigned vm_quantum_shift;
+  vmem_size_t vm_size;  /* total size of all spans */
+  vmem_size_t vm_inuse; /* total size of allocated ranges */
+  bt_seglist_t vm_seglist;
+  bt_list_t vm_freelist[VMEM_MAXORDER];
+  bt_list_t vm_hashlist[VMEM_HASHSIZE];
+  unsigned vm_nqcache;
+  vmem_qcache_t vm_qcache[VMEM_QCACHE_MAX];
+} vmem_t;
+
+/*! \brief Initializes an empty arena.
+ *
+ * \a quantum is the smallest unit of allocation and must be a power of two.
+ * Requests up to \a qcache_max bytes are served by quantum caches. */
+void vmem_init(vmem_t *vm, const char *name, vmem_size_t quantum,
+               vmem_size_t qcache_max);
+
+/*! \brief Releases all resources held by the arena.
+ *
+ * All ranges must have been freed beforehand. */
+void vmem_destroy(vmem_t *vm);
+
+/*! \brief Adds [addr, addr + size) span to the arena. */
+int vmem_add(vmem_t *vm, vmem_addr_t addr, vmem_size_t size);
+
+/*! \brief Allocates a range of \a size bytes.
+ *
+ * \returns 0 and sets *addrp on success, -ENOMEM otherwise */
+int vmem_alloc(vmem_t *vm, vmem_size_t size, vmem_addr_t *addrp);
+
+/*! \brief Returns a range obtained with vmem_alloc. */
+void vmem_free(vmem_t *vm, vmem_addr_t addr, vmem_size_t size);
+
+#endif /* !_SYS_VMEM_H_ */
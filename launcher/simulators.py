@@ -66,7 +66,7 @@ class QEMU(Launchable):
                         '-device', 'VGA',
                         '-machine', 'malta',
                         '-cpu', '24Kf',
-                        '-icount', 'shift=3,sleep=on',
+                        '-smp', str(kwargs['smp']),
                         '-kernel', kwargs['kernel'],
                         '-append', kwargs['args'],
                         '-gdb', 'tcp::%d' % kwargs['gdb_port'],
@@ -74,6 +74,10 @@ class QEMU(Launchable):
                         '-serial', 'null',
                         '-serial', 'null',
                         '-serial', 'tcp:127.0.0.1:%d,server,wait' % port]
+        # Instruction counting forces processors to be emulated one at a time.
+        if kwargs['smp'] == 1:
+            self.options += ['-icount', 'shift=3,sleep=on']
+
         if kwargs['debug']:
             self.options += ['-S']
 
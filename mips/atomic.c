@@ -52,3 +52,11 @@ int atomic_cmp_exchange(volatile uint32_t *p, uint32_t cmpval,
 void atomic_store(volatile uint32_t *p, uint32_t val) {
   atomic_store_rel_32(p, val);
 }
+
+uint32_t atomic_add(volatile uint32_t *p, uint32_t val) {
+  uint32_t old;
+  do {
+    old = *p;
+  } while (!atomic_cmpset_acq_32(p, old, old + val));
+  return old + val;
+}
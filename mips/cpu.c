@@ -51,7 +51,10 @@ static bool cpu_read_config(void) {
     1 << (_mips32r2_ext(config1, CFG1_DS_SHIFT, CFG1_DS_BITS) + 6);
   cpuinfo.dc_size = cpuinfo.dc_nways * cpuinfo.dc_linesize * cpuinfo.dc_nsets;
 
+  cpuinfo.fpu = (config1 & CFG1_FP) ? 1 : 0;
+
   klog("TLB Entries: %d", cpuinfo.tlb_entries);
+  klog("FPU: %s", cpuinfo.fpu ? "yes" : "no");
 
   klog("I-cache: %d KiB, %d-way associative, line size: %d bytes",
        cpuinfo.ic_size / 1024, cpuinfo.ic_nways, cpuinfo.ic_linesize);
@@ -140,4 +143,7 @@ static void cpu_dump(void) {
 void cpu_init(void) {
   cpu_read_config();
   cpu_dump();
+
+  /* Let user programs read cycle counter and processor number. */
+  mips32_set_c0(C0_HWRENA, HWRENA_CC | HWRENA_CPUNUM);
 }
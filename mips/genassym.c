@@ -128,5 +128,8 @@ ASSYM(USER_EXC_FRAME_SIZE, sizeof(exc_frame_t));
 
 ASSYM(P_USPACE, offsetof(proc_t, p_uspace));
 
+ASSYM(MAXCPU, MAXCPU);
+
 ASSYM(PCPU_CURTHREAD, offsetof(pcpu_t, curthread));
 ASSYM(PCPU_KSP, offsetof(pcpu_t, ksp));
+ASSYM(PCPU_USPACE, offsetof(pcpu_t, uspace));
@@ -9,13 +9,17 @@
 #include <pmap.h>
 #include <spinlock.h>
 #include <queue.h>
+#include <smp.h>
 #include <sysent.h>
 #include <thread.h>
+#include <proc.h>
 #include <ktest.h>
 
 typedef void (*exc_handler_t)(exc_frame_t *);
 
 extern const char _ebase[];
+extern const char mips_intr_wait_start[];
+extern const char mips_intr_wait_end[];
 
 /* Extra information regarding DI / EI usage (from MIPS® ISA documentation):
  *
@@ -54,7 +58,7 @@ static intr_chain_t mips_intr_chain[8] = {
   MIPS_INTR_CHAIN(MIPS_HWINT4, "hwint(4)"),
   MIPS_INTR_CHAIN(MIPS_HWINT5, "hwint(5)")};
 
-void mips_intr_init(void) {
+void mips_intr_cpu_init(void) {
   /*
    * Enable Vectored Interrupt Mode as described in „MIPS32® 24KETM Processor
    * Core Family Software User’s Manual”, chapter 6.3.1.2.
@@ -67,6 +71,10 @@ void mips_intr_init(void) {
   mips32_bs_c0(C0_CAUSE, CR_IV);
   /* Set vector spacing to 0. */
   mips32_set_c0(C0_INTCTL, INTCTL_VS_0);
+}
+
+void mips_intr_init(void) {
+  mips_intr_cpu_init();
 
   for (unsigned i = 0; i < 8; i++)
     intr_chain_register(&mips_intr_chain[i]);
@@ -96,6 +104,16 @@ void mips_intr_teardown(intr_handler_t *handler) {
 void mips_intr_handler(exc_frame_t *frame) {
   assert(intr_disabled());
 
+  /* Idle thread releases BKL while it waits for work. */
+  bool locked = !bkl_owned();
+  if (locked)
+    bkl_acquire();
+
+  /* Processor must not halt after the interrupt that should wake it up. */
+  if (frame->pc >= (reg_t)mips_intr_wait_start &&
+      frame->pc < (reg_t)mips_intr_wait_end)
+    frame->pc = (reg_t)mips_intr_wait_end;
+
   unsigned pending = (frame->cause & frame->sr) & CR_IP_MASK;
 
   for (int i = 7; i >= 0; i--) {
@@ -111,6 +129,9 @@ void mips_intr_handler(exc_frame_t *frame) {
 
   exc_before_leave(frame);
 
+  if (locked)
+    bkl_release();
+
   assert(intr_disabled());
 }
 
@@ -171,7 +192,8 @@ finalize:
 static void fpe_handler(exc_frame_t *frame) {
   thread_t *td = thread_self();
   if (td->td_proc) {
-    sig_send(td->td_proc, SIGFPE);
+    WITH_MTX_LOCK (&td->td_proc->p_lock)
+      sig_send(td->td_proc, SIGFPE);
   } else {
     panic("Floating point exception or integer overflow in a kernel thread.");
   }
@@ -184,7 +206,9 @@ static void cp_unusable_handler(exc_frame_t *frame) {
 
   int cp_id = (frame->cause & CR_CEMASK) >> CR_CESHIFT;
   if (cp_id != 1) {
-    sig_send(thread_self()->td_proc, SIGILL);
+    proc_t *p = thread_self()->td_proc;
+    WITH_MTX_LOCK (&p->p_lock)
+      sig_send(p, SIGILL);
   } else {
     /* Enable FPU for interrupted context. */
     frame->sr |= SR_CU1;
@@ -193,7 +217,9 @@ static void cp_unusable_handler(exc_frame_t *frame) {
 
 static void ri_handler(exc_frame_t *frame) {
   assert(!in_kernel_mode(frame));
-  sig_send(thread_self()->td_proc, SIGILL);
+  proc_t *p = thread_self()->td_proc;
+  WITH_MTX_LOCK (&p->p_lock)
+    sig_send(p, SIGILL);
 }
 
 /*
@@ -10,12 +10,15 @@
 #include <mips/tlb.h>
 #include <klog.h>
 #include <kbss.h>
+#include <kva.h>
 #include <console.h>
 #include <pcpu.h>
 #include <pmap.h>
 #include <pool.h>
 #include <stdc.h>
 #include <sleepq.h>
+#include <smp.h>
+#include <swap.h>
 #include <rman.h>
 #include <thread.h>
 #include <turnstile.h>
@@ -126,7 +129,33 @@ extern uint8_t __kernel_start[];
 static void pm_bootstrap(unsigned memsize) {
   pm_init();
 
-  pm_seg_t *seg = kbss_grow(pm_seg_space_needed(memsize));
+  /*
+   * Firmware reports memory that is not accessible at low physical addresses
+   * with "ememsize" variable. It is managed as a separate segment, which is
+   * not covered by KSEG0 and thus used only by kernel allocators that can map
+   * pages into KSEG2.
+   */
+  size_t ememsize = 0;
+  const char *ememsize_str = kenv_get("ememsize");
+  if (ememsize_str)
+    ememsize = min(strtoul(ememsize_str, NULL, 10), MALTA_PHYS_SDRAM_HIGH_MAX);
+  ememsize = rounddown(ememsize, PAGESIZE);
+
+  pm_seg_t *hseg = NULL;
+  if (ememsize > memsize)
+    hseg = kbss_grow(pm_seg_space_needed(ememsize - memsize));
+
+  /*
+   * Top of memory can be set aside as swap space with "swapsize" argument,
+   * which is expressed in megabytes. At most half of memory can be used.
+   */
+  size_t swapsize = 0;
+  const char *swapsize_str = kenv_get("swapsize");
+  if (swapsize_str)
+    swapsize = min(strtoul(swapsize_str, NULL, 10) << 20, memsize / 2);
+  paddr_t swap_start = MALTA_PHYS_SDRAM_BASE + memsize - swapsize;
+
+  pm_seg_t *seg = kbss_grow(pm_seg_space_needed(memsize - swapsize));
 
   /*
    * Let's fix size of kernel bss section. We need to tell physical memory
@@ -136,14 +165,22 @@ static void pm_bootstrap(unsigned memsize) {
   void *__kernel_end = kbss_fix();
 
   /* create Malta physical memory segment */
-  pm_seg_init(seg, MALTA_PHYS_SDRAM_BASE, MALTA_PHYS_SDRAM_BASE + memsize,
-              MIPS_KSEG0_START);
+  pm_seg_init(seg, MALTA_PHYS_SDRAM_BASE, swap_start, MIPS_KSEG0_START);
 
   /* reserve kernel image and physical memory description space */
   pm_seg_reserve(seg, MIPS_KSEG0_TO_PHYS(__kernel_start),
                  MIPS_KSEG0_TO_PHYS(__kernel_end));
 
   pm_add_segment(seg);
+
+  if (hseg) {
+    pm_seg_init(hseg, MALTA_PHYS_SDRAM_HIGH + memsize,
+                MALTA_PHYS_SDRAM_HIGH + ememsize, 0);
+    pm_add_segment(hseg);
+  }
+
+  if (swapsize > 0)
+    swap_ram_attach(swap_start, swapsize);
 }
 
 static void thread_bootstrap(void) {
@@ -164,13 +201,15 @@ void platform_init(int argc, char **argv, char **envp, unsigned memsize) {
   setup_kenv(argc, argv, envp);
   cn_init();
   klog_init();
-  pcpu_init();
-  cpu_init();
   tlb_init();
+  pcpu_init(0);
+  bkl_acquire();
+  cpu_init();
   mips_timer_init();
   mips_intr_init();
   pm_bootstrap(memsize);
   pmap_init();
+  kva_init();
   pool_bootstrap();
   kmem_bootstrap();
   sleepq_init();
@@ -0,0 +1,70 @@
+#define KL_LOG KL_INIT
+#include <klog.h>
+#include <stdc.h>
+#include <atomic.h>
+#include <context.h>
+#include <physmem.h>
+#include <pcpu.h>
+#include <pmap.h>
+#include <sched.h>
+#include <smp.h>
+#include <thread.h>
+#include <mips/cpuinfo.h>
+#include <mips/intr.h>
+#include <mips/mips.h>
+#include <mips/timer.h>
+#include <mips/tlb.h>
+
+/*
+ * All processors enter the kernel at _start. Secondary ones increment
+ * mp_nparked and spin until the boot processor gives them a stack by writing
+ * its top to mp_bootstack[cpuid]. Then they jump into mp_bootstrap.
+ */
+volatile uint32_t mp_nparked;
+volatile uint32_t mp_bootstack[MAXCPU];
+
+/* Value of cycle counter of the boot processor, when it released a secondary
+ * processor. Used to keep counters of all processors roughly in sync. */
+static volatile uint32_t mp_count;
+
+static thread_t *mp_idle_thread[MAXCPU];
+
+noreturn void mp_bootstrap(unsigned cpuid) {
+  mips32_set_c0(C0_COUNT, mp_count);
+
+  tlb_init();
+  pcpu_init(cpuid);
+  bkl_acquire();
+
+  cpu_init();
+  mips_intr_cpu_init();
+  mips_timer_cpu_init();
+  pmap_activate(NULL);
+
+  atomic_add(&ncpus, 1);
+  klog("Processor %d is up and running.", cpuid);
+
+  thread_t *td = mp_idle_thread[cpuid];
+  td->td_state = TDS_RUNNING;
+  ctx_switch(NULL, td);
+  panic("Processor %d returned from idle thread!", cpuid);
+}
+
+void smp_start(void) {
+  unsigned nparked = min(mp_nparked, MAXCPU - 1U);
+
+  for (unsigned cpuid = 1; cpuid <= nparked; cpuid++) {
+    vm_page_t *pg = pm_alloc(1);
+    if (pg == NULL)
+      panic("Cannot allocate boot stack for processor %d!", cpuid);
+
+    mp_idle_thread[cpuid] =
+      thread_create("idle-thread", (void (*)(void *))sched_run, NULL);
+
+    mp_count = mips32_get_c0(C0_COUNT);
+    atomic_store(&mp_bootstack[cpuid],
+                 (intptr_t)PG_KSEG0_ADDR(pg) + PAGESIZE);
+  }
+
+  klog("Started %d secondary processors.", nparked);
+}
@@ -5,16 +5,19 @@
 #include <mips/exc.h>
 #include <mips/mips.h>
 #include <mips/tlb.h>
+#include <mips/cpuinfo.h>
 #include <mips/pmap.h>
 #include <pcpu.h>
 #include <pmap.h>
 #include <vm_map.h>
 #include <thread.h>
+#include <proc.h>
 #include <ktest.h>
 #include <signal.h>
 #include <spinlock.h>
 #include <mutex.h>
 #include <sched.h>
+#include <smp.h>
 #include <interrupt.h>
 #include <sysinit.h>
 
@@ -29,10 +32,23 @@ static POOL_DEFINE(P_PMAP, "pmap", sizeof(pmap_t));
 
 #define PTE_KERNEL (PTE_VALID | PTE_DIRTY | PTE_GLOBAL)
 
+#define PTE_PGSZ_MASK (((1 << PTE_PGSZ_BITS) - 1) << PTE_PGSZ_SHIFT)
+#define PTE_PGSZ(idx) ((idx) << PTE_PGSZ_SHIFT)
+#define PTE_PGSZ_OF(pte) (((pte)&PTE_PGSZ_MASK) >> PTE_PGSZ_SHIFT)
+
+/* Size of a large page with given index. Single TLB entry maps a pair of
+ * such pages, so large pages always come in windows of twice that size. */
+#define LPAGE_SIZE(idx) (PAGESIZE << (2 * (idx)))
+
 static bool is_valid(pte_t pte) {
   return pte & PTE_VALID;
 }
 
+/* Entry is live if it holds a mapping, even one that cannot be accessed. */
+static bool is_live(pte_t pte) {
+  return pte & ~PTE_GLOBAL;
+}
+
 static bool in_user_space(vaddr_t addr) {
   return addr < PMAP_USER_END;
 }
@@ -42,26 +58,58 @@ static bool in_kernel_space(vaddr_t addr) {
 }
 
 static pmap_t kernel_pmap;
-static bitstr_t asid_used[bitstr_size(MAX_ASID)] = {0};
+
+/*
+ * ASIDs are handed out lazily on pmap activation. When ASID space gets
+ * exhausted a new generation begins -- all non-wired TLB entries are flushed
+ * and every pmap will have to obtain a new ASID once activated. Thus pmaps
+ * never return ASIDs and no TLB scan is needed when a pmap is destroyed.
+ *
+ * ASID 0 is reserved for kernel pmap, which contains only global mappings.
+ */
+static unsigned asid_next = 1;
+static uint32_t asid_generation = 1;
 static spinlock_t *asid_lock = &SPINLOCK_INITIALIZER();
 
-static asid_t alloc_asid(void) {
-  int free;
-  WITH_SPINLOCK(asid_lock) {
-    bit_ffc(asid_used, MAX_ASID, &free);
-    if (free < 0)
-      panic("Out of asids!");
-    bit_set(asid_used, free);
-  }
-  klog("alloc_asid() = %d", free);
-  return free;
+static void pmap_tlb_shootdown(pmap_t *pmap, vaddr_t start, vaddr_t end);
+
+static void pmap_asid_assign(pmap_t *pmap) {
+  pmap->asid = asid_next++;
+  pmap->asid_gen = asid_generation;
+  klog("Assigned ASID %d to pmap %p", pmap->asid, pmap);
 }
 
-static void free_asid(asid_t asid) {
-  klog("free_asid(%d)", asid);
+static void pmap_asid_update(pmap_t *pmap) {
   SCOPED_SPINLOCK(asid_lock);
-  bit_clear(asid_used, (unsigned)asid);
-  tlb_invalidate_asid(asid);
+
+  if (pmap->asid_gen == asid_generation)
+    return;
+
+  if (asid_next > MAX_ASID) {
+    asid_generation++;
+    asid_next = 1;
+    tlb_invalidate_all();
+    klog("ASID generation %d begins", asid_generation);
+
+    if (ncpus > 1) {
+      /* Pmaps active on other processors are not going to be activated again
+       * before they're used, so they get new ASIDs right away. */
+      for (unsigned i = 0; i < MAXCPU; i++) {
+        pmap_t *active = _pcpu_data[i].curpmap;
+        if (active && active->asid_gen != asid_generation)
+          pmap_asid_assign(active);
+      }
+      pmap_tlb_shootdown(NULL, 0, 0);
+    }
+  }
+
+  if (pmap->asid_gen != asid_generation)
+    pmap_asid_assign(pmap);
+}
+
+/* Only a pmap with ASID from current generation may have entries in TLB. */
+static bool pmap_asid_valid(pmap_t *pmap) {
+  return pmap == &kernel_pmap || pmap->asid_gen == asid_generation;
 }
 
 static void update_wired_pde(pmap_t *umap) {
@@ -76,7 +124,149 @@ static void update_wired_pde(pmap_t *umap) {
   if (umap)
     e.lo0 = PTE_PFN(umap->pde_page->paddr) | PTE_KERNEL;
 
-  tlb_write(0, &e);
+  tlb_write(TLB_WIRED_PDE, &e);
+}
+
+/*
+ * Page table pages released by pmaps are kept in a cache, instead of being
+ * returned to physical memory allocator right away. Idle thread initializes
+ * released pages and keeps a few ready pages around, so that pmap_add_pde
+ * usually does not need to touch all entries of a new page table.
+ */
+#define PT_CACHE_MAX 16 /* maximum number of cached page tables */
+#define PT_CACHE_MIN 4  /* idle thread keeps that many ready page tables */
+
+static spinlock_t *pt_cache_lock = &SPINLOCK_INITIALIZER();
+static pg_list_t pt_ready = TAILQ_HEAD_INITIALIZER(pt_ready);
+static pg_list_t pt_dirty = TAILQ_HEAD_INITIALIZER(pt_dirty);
+static unsigned pt_nready, pt_ndirty;
+static unsigned pt_hits, pt_misses;
+
+static void pmap_pt_init(vm_page_t *pg) {
+  pte_t *pte = PG_KSEG0_ADDR(pg);
+  for (int i = 0; i < PT_ENTRIES; i++)
+    pte[i] = PTE_GLOBAL;
+  pg->nptes = 0;
+}
+
+/*! \brief Returns a page table with all entries invalid. */
+static vm_page_t *pmap_pt_alloc(void) {
+  vm_page_t *pg;
+  bool ready = false;
+
+  WITH_SPINLOCK(pt_cache_lock) {
+    if ((pg = TAILQ_FIRST(&pt_ready))) {
+      TAILQ_REMOVE(&pt_ready, pg, pageq);
+      pt_nready--;
+      pt_hits++;
+      ready = true;
+    } else if ((pg = TAILQ_FIRST(&pt_dirty))) {
+      TAILQ_REMOVE(&pt_dirty, pg, pageq);
+      pt_ndirty--;
+      pt_misses++;
+    } else {
+      pt_misses++;
+    }
+  }
+
+  if (ready)
+    return pg;
+
+  if (pg == NULL && (pg = pm_alloc(1)) == NULL)
+    panic("out of memory for page tables");
+
+  pmap_pt_init(pg);
+  return pg;
+}
+
+/*! \brief Puts page tables from \a pages into the cache while there's room.
+ *
+ * Page tables that did not fit are left on the list. They may hold stale
+ * entries, so the idle thread has to clear them before reuse. */
+static void pmap_pt_cache(pg_list_t *pages) {
+  SCOPED_SPINLOCK(pt_cache_lock);
+
+  vm_page_t *pg;
+  while (pt_nready + pt_ndirty < PT_CACHE_MAX && (pg = TAILQ_FIRST(pages))) {
+    TAILQ_REMOVE(pages, pg, pageq);
+    TAILQ_INSERT_TAIL(&pt_dirty, pg, pageq);
+    pt_ndirty++;
+  }
+}
+
+/*! \brief Puts page table with all entries invalid into the cache.
+ *
+ * \returns false if there was no room for it */
+static bool pmap_pt_cache_ready(vm_page_t *pg) {
+  SCOPED_SPINLOCK(pt_cache_lock);
+
+  if (pt_nready + pt_ndirty >= PT_CACHE_MAX)
+    return false;
+
+  TAILQ_INSERT_TAIL(&pt_ready, pg, pageq);
+  pt_nready++;
+  return true;
+}
+
+bool pmap_idle(void) {
+  vm_page_t *pg = NULL;
+  bool refill = false;
+
+  WITH_SPINLOCK(pt_cache_lock) {
+    if ((pg = TAILQ_FIRST(&pt_dirty))) {
+      TAILQ_REMOVE(&pt_dirty, pg, pageq);
+      pt_ndirty--;
+    } else {
+      refill = pt_nready < PT_CACHE_MIN;
+    }
+  }
+
+  if (refill)
+    pg = pm_alloc(1);
+
+  if (pg == NULL)
+    return false;
+
+  pmap_pt_init(pg);
+
+  WITH_SPINLOCK(pt_cache_lock) {
+    TAILQ_INSERT_TAIL(&pt_ready, pg, pageq);
+    pt_nready++;
+  }
+  return true;
+}
+
+size_t pmap_reclaim(void) {
+  pg_list_t pages;
+  vm_page_t *pg;
+  size_t npages;
+
+  TAILQ_INIT(&pages);
+
+  WITH_SPINLOCK(pt_cache_lock) {
+    while ((pg = TAILQ_FIRST(&pt_ready))) {
+      TAILQ_REMOVE(&pt_ready, pg, pageq);
+      TAILQ_INSERT_TAIL(&pages, pg, pageq);
+    }
+    while ((pg = TAILQ_FIRST(&pt_dirty))) {
+      TAILQ_REMOVE(&pt_dirty, pg, pageq);
+      TAILQ_INSERT_TAIL(&pages, pg, pageq);
+    }
+    npages = pt_nready + pt_ndirty;
+    pt_nready = pt_ndirty = 0;
+  }
+
+  if (npages > 0)
+    pm_free_list(&pages);
+  return npages;
+}
+
+void pmap_stats(pmap_stats_t *stats) {
+  SCOPED_SPINLOCK(pt_cache_lock);
+  stats->pt_cache_hits = pt_hits;
+  stats->pt_cache_misses = pt_misses;
+  stats->pt_cache_ready = pt_nready;
+  stats->pt_cache_dirty = pt_ndirty;
 }
 
 /* Page Table is accessible only through physical addresses. */
@@ -86,7 +276,8 @@ static void pmap_setup(pmap_t *pmap, vaddr_t start, vaddr_t end) {
   pmap->pde = PG_KSEG0_ADDR(pde_page);
   pmap->start = start;
   pmap->end = end;
-  pmap->asid = alloc_asid();
+  pmap->asid = 0;
+  pmap->asid_gen = 0;
   mtx_init(&pmap->mtx, MTX_DEF);
   klog("Page directory table allocated at %p", (vaddr_t)pmap->pde);
   TAILQ_INIT(&pmap->pte_pages);
@@ -95,15 +286,17 @@ static void pmap_setup(pmap_t *pmap, vaddr_t start, vaddr_t end) {
     pmap->pde[i] = in_kernel_space(i * PT_ENTRIES * PAGESIZE) ? PTE_GLOBAL : 0;
 }
 
-/* TODO: remove all mappings from TLB, evict related cache lines */
+/* TODO: evict related cache lines */
 void pmap_reset(pmap_t *pmap) {
-  while (!TAILQ_EMPTY(&pmap->pte_pages)) {
-    vm_page_t *pg = TAILQ_FIRST(&pmap->pte_pages);
-    TAILQ_REMOVE(&pmap->pte_pages, pg, pageq);
-    pm_free(pg);
-  }
-  pm_free(pmap->pde_page);
-  free_asid(pmap->asid);
+  /* Page tables are dropped in one sweep, without clearing their entries.
+   * Some go to page table cache, the rest is returned to physical memory. */
+  pmap_pt_cache(&pmap->pte_pages);
+  TAILQ_INSERT_TAIL(&pmap->pte_pages, pmap->pde_page, pageq);
+  pm_free_list(&pmap->pte_pages);
+  pmap->pde_page = NULL;
+  pmap->pde = NULL;
+  /* ASID is not reused until next generation, which flushes TLB anyway. */
+  pmap->asid_gen = 0;
 }
 
 void pmap_init(void) {
@@ -117,6 +310,12 @@ pmap_t *pmap_new(void) {
 }
 
 void pmap_delete(pmap_t *pmap) {
+  /* Address spaces are switched lazily, so other processors may still have
+   * the pmap loaded, though they don't use it. */
+  for (unsigned i = 0; i < MAXCPU; i++)
+    if (_pcpu_data[i].curpmap == pmap)
+      _pcpu_data[i].curpmap = NULL;
+
   pmap_reset(pmap);
   pool_free(P_PMAP, pmap);
 }
@@ -132,20 +331,139 @@ static pte_t pmap_pte_read(pmap_t *pmap, vaddr_t vaddr) {
   return PTE_OF(pde, vaddr);
 }
 
+/*! \brief Returns descriptor of page table page referenced by \a pde. */
+static vm_page_t *pmap_pde_page(pte_t pde) {
+  return pm_find_page(MIPS_KSEG0_TO_PHYS(PTE_FRAME_ADDR(pde)));
+}
+
+/* Ranges spanning more pages are flushed from TLB by ASID. */
+#define PMAP_INVALIDATE_MAX 16
+
+/*! \brief Drops TLB entries mapping [start, end) range of \a pmap.
+ *
+ * Each TLB entry maps a pair of pages, so probing is done per pair. For large
+ * ranges it's cheaper to scan TLB once and drop all entries of the pmap. */
+static void pmap_tlb_invalidate_range(pmap_t *pmap, vaddr_t start,
+                                      vaddr_t end) {
+  if (!pmap_asid_valid(pmap))
+    return;
+
+  if ((end - start) / PAGESIZE > PMAP_INVALIDATE_MAX) {
+    /* Kernel entries are global, so they cannot be selected by ASID. */
+    if (pmap == &kernel_pmap)
+      tlb_invalidate_all();
+    else
+      tlb_invalidate_asid(PTE_ASID(pmap->asid));
+    return;
+  }
+
+  for (vaddr_t va = PTE_VPN2(start); va < end; va += 2 * PAGESIZE)
+    tlb_invalidate(va | PTE_ASID(pmap->asid));
+}
+
+/*
+ * Other processors may hold TLB entries of any pmap, as it could have been
+ * active there before. While this processor holds BKL, the others either run
+ * user code or are idle, so they use no entries but those of their active
+ * user pmap. Only a processor that runs user code of \a pmap has to drop its
+ * entries right away. The range is passed to it in static variables guarded
+ * by BKL, and this processor waits until it's done. Everyone else is asked to
+ * flush whole TLB the next time it enters the kernel.
+ */
+static pmap_t *shootdown_pmap;
+static vaddr_t shootdown_start, shootdown_end;
+
+/*! \brief Drops TLB entries of [start, end) range of \a pmap on all other
+ * processors. If \a pmap is NULL, they flush whole TLB and reload ASID. */
+static void pmap_tlb_shootdown(pmap_t *pmap, vaddr_t start, vaddr_t end) {
+  assert(bkl_owned());
+
+  pcpu_t *target = NULL;
+
+  shootdown_pmap = pmap;
+  shootdown_start = start;
+  shootdown_end = end;
+
+  for (unsigned i = 0; i < MAXCPU; i++) {
+    pcpu_t *pc = &_pcpu_data[i];
+    if (pc == _pcpu() || !pc->running)
+      continue;
+    /* User processes are single-threaded, so at most one processor runs
+     * user code of a pmap. */
+    if (pmap != NULL && pmap == pc->curpmap &&
+        pc->curthread != pc->idle_thread) {
+      ipi_post(pc, IPI_TLB_SHOOTDOWN);
+      target = pc;
+    } else {
+      ipi_post(pc, IPI_TLB_FLUSH);
+    }
+  }
+
+  if (target)
+    ipi_wait(target, IPI_TLB_SHOOTDOWN);
+}
+
+void pmap_tlb_shootdown_ipi(void) {
+  pmap_tlb_invalidate_range(shootdown_pmap, shootdown_start, shootdown_end);
+}
+
+void pmap_tlb_flush_ipi(void) {
+  pmap_t *pmap = PCPU_GET(curpmap);
+  tlb_invalidate_all();
+  mips32_setentryhi(pmap ? pmap->asid : 0);
+}
+
+/*
+ * TLB maintenance is deferred, so that an operation on a range of pages drops
+ * stale TLB entries in one go, rather than probing TLB for each PTE written.
+ * Pages that need that are gathered into a single range.
+ */
+static void pmap_tlb_defer(pmap_t *pmap, vaddr_t vaddr) {
+  vaddr_t start = PTE_VPN2(vaddr);
+  vaddr_t end = start + 2 * PAGESIZE;
+
+  if (pmap->inval_start < pmap->inval_end) {
+    start = min(start, pmap->inval_start);
+    end = max(end, pmap->inval_end);
+  }
+
+  pmap->inval_start = start;
+  pmap->inval_end = end;
+}
+
+/*! \brief Drops TLB entries that were marked stale with pmap_tlb_defer. */
+static void pmap_update(pmap_t *pmap) {
+  assert(mtx_owned(&pmap->mtx));
+
+  if (pmap->inval_start < pmap->inval_end) {
+    pmap_tlb_invalidate_range(pmap, pmap->inval_start, pmap->inval_end);
+    if (ncpus > 1)
+      pmap_tlb_shootdown(pmap, pmap->inval_start, pmap->inval_end);
+  }
+  pmap->inval_start = pmap->inval_end = 0;
+}
+
 /*! \brief Writes \a pte as the new PTE mapping virtual address \a vaddr. */
 static void pmap_pte_write(pmap_t *pmap, vaddr_t vaddr, pte_t pte) {
   pte_t pde = PDE_OF(pmap, vaddr);
   if (!is_valid(pde))
     pde = pmap_add_pde(pmap, vaddr);
+  pte_t old = PTE_OF(pde, vaddr);
   PTE_OF(pde, vaddr) = pte;
-  tlb_invalidate(PTE_VPN2(vaddr) | PTE_ASID(pmap->asid));
+  if (is_live(old) != is_live(pte))
+    pmap_pde_page(pde)->nptes += is_live(pte) ? 1 : -1;
+  /* TLB can hold a copy of the entry only if it was valid, or if the other
+   * page of the pair was valid, when TLB refill handler loaded them both. */
+  if (is_valid(old) ||
+      (is_valid(pte) && is_valid(PTE_OF(pde, vaddr ^ PAGESIZE))))
+    pmap_tlb_defer(pmap, vaddr);
 }
 
 /* Add PT to PD so kernel can handle access to @vaddr. */
 static pde_t pmap_add_pde(pmap_t *pmap, vaddr_t vaddr) {
   assert(!is_valid(PDE_OF(pmap, vaddr)));
 
-  vm_page_t *pg = pm_alloc(1);
+  vm_page_t *pg = pmap_pt_alloc();
   pte_t *pte = PG_KSEG0_ADDR(pg);
 
   TAILQ_INSERT_TAIL(&pmap->pte_pages, pg, pageq);
@@ -154,14 +472,100 @@ static pde_t pmap_add_pde(pmap_t *pmap, vaddr_t vaddr) {
   pte_t pde = PTE_PFN((paddr_t)pte) | PTE_KERNEL;
 
   PDE_OF(pmap, vaddr) = pde;
-  for (int i = 0; i < PT_ENTRIES; i++)
-    pte[i] = PTE_GLOBAL;
-
   return pde;
 }
 
-/* TODO: implement */
-void pmap_remove_pde(pmap_t *pmap, vaddr_t vaddr);
+/* Remove PT covering @vaddr from PD and release its page. */
+static void pmap_remove_pde(pmap_t *pmap, vaddr_t vaddr) {
+  pte_t pde = PDE_OF(pmap, vaddr);
+  vm_page_t *pg = pmap_pde_page(pde);
+
+  assert(is_valid(pde) && pg->nptes == 0);
+
+  klog("Page table for %08lx released", vaddr & PDE_INDEX_MASK);
+
+  PDE_OF(pmap, vaddr) = in_kernel_space(vaddr) ? PTE_GLOBAL : 0;
+  TAILQ_REMOVE(&pmap->pte_pages, pg, pageq);
+
+  /* No live entries are left, so the page table needs no clearing. */
+  if (!pmap_pt_cache_ready(pg))
+    pm_free(pg);
+}
+
+/*! \brief Clears PTEs in [start, end) range covered by single page table.
+ *
+ * Releases the page table once it holds no live entries. */
+static void pmap_remove_ptes(pmap_t *pmap, vaddr_t start, vaddr_t end) {
+  pte_t pde = PDE_OF(pmap, start);
+  if (!is_valid(pde))
+    return;
+
+  vm_page_t *pg = pmap_pde_page(pde);
+
+  /* Cleared entries look the same as those set up by pmap_pt_init. */
+  for (vaddr_t va = start; va < end; va += PAGESIZE) {
+    pte_t old = PTE_OF(pde, va);
+    if (is_live(old))
+      pg->nptes--;
+    if (is_valid(old))
+      pmap_tlb_defer(pmap, va);
+    PTE_OF(pde, va) = PTE_GLOBAL;
+  }
+
+  if (pg->nptes == 0)
+    pmap_remove_pde(pmap, start);
+}
+
+/*! \brief Picks the biggest large page that can map [va, va + len) at pa.
+ *
+ * \returns page size index or 0 if only 4KiB pages can be used */
+static unsigned pmap_lpage_index(vaddr_t va, paddr_t pa, size_t len) {
+  for (unsigned idx = PTE_PGSZ_MAX; idx > 0; idx--) {
+    size_t size = LPAGE_SIZE(idx);
+    if (is_aligned(va, 2 * size) && is_aligned(pa, size) && len >= 2 * size)
+      return idx;
+  }
+  return 0;
+}
+
+/* Frame number stored in the PTE of \a va that belongs to the large page
+ * window of \a size pages mapped at \a pa. Even PTEs point to the beginning of
+ * the even half, odd PTEs to the beginning of the odd half. Hence any pair of
+ * PTEs loaded by TLB refill handler describes the whole window. */
+static pte_t pmap_lpage_pfn(vaddr_t va, paddr_t pa, size_t size) {
+  return PTE_PFN(pa + ((va & PAGESIZE) ? size : 0));
+}
+
+/*! \brief Breaks large page window containing \a va into 4KiB pages.
+ *
+ * Every PTE of the window gets its own frame number, while protection bits are
+ * preserved. Rewriting the PTEs drops the large page entry from TLB. */
+static void pmap_demote(pmap_t *pmap, vaddr_t va) {
+  unsigned idx = PTE_PGSZ_OF(pmap_pte_read(pmap, va));
+  if (idx == 0)
+    return;
+
+  size_t size = LPAGE_SIZE(idx);
+  vaddr_t start = va & -(2 * size);
+  vaddr_t end = start + 2 * size;
+
+  klog("Demote large page mapping %p-%p", start, end);
+
+  for (va = start; va < end; va += PAGESIZE) {
+    pte_t pte = pmap_pte_read(pmap, va);
+    if (PTE_PGSZ_OF(pte) != idx)
+      continue;
+    paddr_t pa = PTE_FRAME_ADDR(pte) - ((va & PAGESIZE) ? size : 0);
+    pte &= ~(PTE_PGSZ_MASK | PTE_PFN_MASK);
+    pmap_pte_write(pmap, va, pte | PTE_PFN(pa + (va - start)));
+  }
+}
+
+/* Demote large pages that stick out of [start, end) range. */
+static void pmap_demote_range(pmap_t *pmap, vaddr_t start, vaddr_t end) {
+  pmap_demote(pmap, start);
+  pmap_demote(pmap, end - PAGESIZE);
+}
 
 #if 0
 /* Used if CPU implements RI and XI bits in ENTRYLO. */
@@ -197,10 +601,31 @@ void pmap_enter(pmap_t *pmap, vaddr_t va, vm_page_t *pg, vm_prot_t prot) {
 
   klog("Enter virtual mapping %p-%p for frame %p", va, va_end, PG_START(pg));
 
+  pte_t bits = vm_prot_map[prot] | (in_kernel_space(va) ? PTE_GLOBAL : 0);
+
   WITH_MTX_LOCK (&pmap->mtx) {
-    for (; va < va_end; va += PAGESIZE, pa += PAGESIZE)
-      pmap_pte_write(pmap, va, PTE_PFN(pa) | vm_prot_map[prot] |
-                                 (in_kernel_space(va) ? PTE_GLOBAL : 0));
+    pmap_demote_range(pmap, va, va_end);
+
+    while (va < va_end) {
+      unsigned idx = pmap_lpage_index(va, pa, va_end - va);
+
+      if (idx == 0) {
+        pmap_pte_write(pmap, va, PTE_PFN(pa) | bits);
+        va += PAGESIZE;
+        pa += PAGESIZE;
+        continue;
+      }
+
+      size_t size = LPAGE_SIZE(idx);
+      klog("Enter large page mapping %p-%p", va, va + 2 * size);
+
+      for (vaddr_t end = va + 2 * size; va < end; va += PAGESIZE)
+        pmap_pte_write(pmap, va,
+                       pmap_lpage_pfn(va, pa, size) | PTE_PGSZ(idx) | bits);
+      pa += 2 * size;
+    }
+
+    pmap_update(pmap);
   }
 }
 
@@ -211,10 +636,14 @@ void pmap_remove(pmap_t *pmap, vaddr_t start, vaddr_t end) {
   klog("Remove page mapping for address range %p-%p", start, end);
 
   WITH_MTX_LOCK (&pmap->mtx) {
-    for (vaddr_t va = start; va < end; va += PAGESIZE)
-      pmap_pte_write(pmap, va, 0);
+    pmap_demote_range(pmap, start, end);
+
+    for (vaddr_t va = start, next; va < end; va = next) {
+      next = min(va | ~PDE_INDEX_MASK, end - 1) + 1;
+      pmap_remove_ptes(pmap, va, next);
+    }
 
-    /* TODO: Deallocate empty page table fragment by calling pmap_remove_pde. */
+    pmap_update(pmap);
   }
 }
 
@@ -226,21 +655,96 @@ void pmap_protect(pmap_t *pmap, vaddr_t start, vaddr_t end, vm_prot_t prot) {
        end);
 
   WITH_MTX_LOCK (&pmap->mtx) {
+    pmap_demote_range(pmap, start, end);
+
     for (vaddr_t va = start; va < end; va += PAGESIZE) {
       pte_t pte = pmap_pte_read(pmap, va);
-      if (pte == 0)
+      if (!is_live(pte))
         continue;
       pmap_pte_write(pmap, va, (pte & ~PTE_PROT_MASK) | vm_prot_map[prot]);
     }
+
+    pmap_update(pmap);
   }
 }
 
+/* Page primitives implemented in page.S */
+void page_zero(void *dst, size_t len);
+void page_copy(void *dst, const void *src, size_t len);
+void page_zero_fpu(void *dst, size_t len);
+void page_copy_fpu(void *dst, const void *src, size_t len);
+
+/* Primitives above prepare cache lines for store assuming they're that long. */
+#define PAGE_LINESIZE 32
+
 void pmap_zero_page(vm_page_t *pg) {
-  bzero(PG_KSEG0_ADDR(pg), PAGESIZE);
+  void *dst = PG_KSEG0_ADDR(pg);
+  size_t len = PG_SIZE(pg);
+
+  if (cpuinfo.dc_linesize != PAGE_LINESIZE) {
+    bzero(dst, len);
+  } else if (cpuinfo.fpu) {
+    /* FPU registers aren't preserved across kernel context switches. */
+    WITH_NO_PREEMPTION
+      page_zero_fpu(dst, len);
+  } else {
+    page_zero(dst, len);
+  }
 }
 
 void pmap_copy_page(vm_page_t *src, vm_page_t *dst) {
-  memcpy(PG_KSEG0_ADDR(dst), PG_KSEG0_ADDR(src), PAGESIZE);
+  void *from = PG_KSEG0_ADDR(src);
+  void *to = PG_KSEG0_ADDR(dst);
+
+  if (cpuinfo.dc_linesize != PAGE_LINESIZE) {
+    memcpy(to, from, PAGESIZE);
+  } else if (cpuinfo.fpu) {
+    WITH_NO_PREEMPTION
+      page_copy_fpu(to, from, PAGESIZE);
+  } else {
+    page_copy(to, from, PAGESIZE);
+  }
+}
+
+/*
+ * Kmap window slots are backed by wired TLB entries of the CPU, hence they
+ * never miss in TLB and have no page table entries. Mapping lives as long as
+ * the thread does not leave the CPU, which is ensured by disabling preemption.
+ */
+void *pmap_kmap(vm_page_t *pg) {
+  preempt_disable();
+
+  if (!PG_HIGHMEM(pg))
+    return PG_KSEG0_ADDR(pg);
+
+  unsigned *used = PCPU_PTR(kmap_used);
+  unsigned slot = ffs(~*used) - 1;
+  if (slot >= TLB_KMAP_SLOTS)
+    panic("kmap window exhausted");
+  *used |= 1 << slot;
+
+  vaddr_t va = PMAP_KMAP_BEGIN + slot * 2 * PAGESIZE;
+  tlbentry_t e = {.hi = PTE_VPN2(va),
+                  .lo0 = PTE_PFN(PG_START(pg)) | PTE_KERNEL,
+                  .lo1 = PTE_GLOBAL};
+  tlb_write(TLB_WIRED_KMAP + slot, &e);
+  return (void *)va;
+}
+
+void pmap_kunmap(void *va) {
+  vaddr_t addr = (vaddr_t)va;
+
+  if (addr >= PMAP_KMAP_BEGIN && addr < PMAP_KMAP_END) {
+    unsigned slot = (addr - PMAP_KMAP_BEGIN) / (2 * PAGESIZE);
+    unsigned *used = PCPU_PTR(kmap_used);
+    assert(*used & (1 << slot));
+    *used &= ~(1 << slot);
+
+    tlbentry_t e = {.hi = PTE_VPN2(addr), .lo0 = PTE_GLOBAL, .lo1 = PTE_GLOBAL};
+    tlb_write(TLB_WIRED_KMAP + slot, &e);
+  }
+
+  preempt_enable();
 }
 
 /* TODO: at any given moment there're two page tables in use:
@@ -257,6 +761,9 @@ void pmap_activate(pmap_t *pmap) {
   PCPU_GET(curpmap) = pmap;
   update_wired_pde(pmap);
 
+  if (pmap)
+    pmap_asid_update(pmap);
+
   /* Set ASID for current process */
   mips32_setentryhi(pmap ? pmap->asid : 0);
 }
@@ -292,8 +799,15 @@ void tlb_exception_handler(exc_frame_t *frame) {
     goto fault;
   }
   vm_prot_t access = (code == EXC_TLBL) ? VM_PROT_READ : VM_PROT_WRITE;
+  pmap_t *pmap = get_active_pmap_by_addr(vaddr);
   intr_enable();
+  /* TLB holds an entry for faulting address, that was found invalid. It will
+   * be dropped together with the PTEs written while handling the fault. */
+  WITH_MTX_LOCK (&pmap->mtx)
+    pmap_tlb_defer(pmap, vaddr);
   int ret = vm_page_fault(map, vaddr, access);
+  WITH_MTX_LOCK (&pmap->mtx)
+    pmap_update(pmap);
   intr_disable();
   if (ret == 0)
     return;
@@ -314,7 +828,8 @@ fault:
      * once pmap & vm_map is properly synchronized it will be removed
      * and whole tlb_exception_handler will run as preemptible code */
     intr_enable();
-    sig_send(td->td_proc, SIGSEGV);
+    WITH_MTX_LOCK (&td->td_proc->p_lock)
+      sig_send(td->td_proc, SIGSEGV);
     intr_disable();
   } else if (ktest_test_running_flag) {
     ktest_failure();
@@ -2,13 +2,22 @@
 #include <mips/config.h>
 #include <mips/intr.h>
 #include <interrupt.h>
+#include <pcpu.h>
+#include <sched.h>
 #include <time.h>
 #include <timer.h>
 
-/* For now, sole purpose of MIPS CPU timer is to provide accurate timestamps
- * for various parts of the system.
+/* MIPS CPU timer provides accurate timestamps for various parts of the system
+ * and serves as one-shot event timer.
  *
- * TODO Integrate with new timer framework. */
+ * Cycle counter is extended to 64 bits in software, hence it must be read at
+ * least once per 2^31 ticks to notice wrap-arounds. Compare register is never
+ * set further away than COMPARE_GUARD ticks to ensure that. */
+
+#define COMPARE_GUARD (1U << 30)
+/* Compare register set too close to the counter may be passed before the
+ * write takes effect, then the interrupt would come after wrap-around. */
+#define COMPARE_MIN_DELAY (10 * TICKS_PER_US)
 
 typedef union {
   struct {
@@ -19,22 +28,49 @@ typedef union {
 } counter_t;
 
 static counter_t count = {.hi = 0, .lo = 0};
-static counter_t compare = {.hi = 1, .lo = 0};
+static uint64_t deadline; /* counter value when one-shot event triggers */
+static bool armed;        /* is there a one-shot event pending? */
+
+static timer_t mips_timer;
 
 static uint64_t read_count(void) {
-  uint64_t now;
-  intr_disable();
-  count.lo = mips32_get_c0(C0_COUNT);
-  now = count.val;
-  intr_enable();
-  return now;
+  SCOPED_INTR_DISABLED();
+  uint32_t lo = mips32_get_c0(C0_COUNT);
+  /* Counters of other processors may lag a little behind, so only a step
+   * forward that crosses zero means that the counter has wrapped around. */
+  if ((int32_t)(lo - count.lo) >= 0) {
+    if (lo < count.lo)
+      count.hi++;
+    count.lo = lo;
+  }
+  return count.val;
 }
 
-static intr_filter_t mips_timer_intr(void *data) {
-  count.hi++;
-  compare.hi++;
+static void set_compare(uint64_t now) {
+  uint64_t when = now + COMPARE_GUARD;
+  if (armed && deadline < when)
+    when = max(deadline, now + COMPARE_MIN_DELAY);
   /* To mark interrupt as handled we need to write to compare register! */
-  mips32_set_c0(C0_COMPARE, compare.lo);
+  mips32_set_c0(C0_COMPARE, (uint32_t)when);
+}
+
+static intr_filter_t mips_timer_intr(void *data) {
+  /* External interrupts are delivered to boot processor only, so the others
+   * use their own timers to tick the scheduler. Counters of all processors
+   * are synchronized at startup, hence only the boot processor keeps track
+   * of overflows. */
+  if (PCPU_GET(cpuid) != 0) {
+    mips32_set_c0(C0_COMPARE, mips32_get_c0(C0_COUNT) + TICKS_PER_MS);
+    sched_clock();
+    return IF_FILTERED;
+  }
+
+  uint64_t now = read_count();
+  if (armed && deadline <= now + COMPARE_MIN_DELAY) {
+    armed = false;
+    tm_trigger(&mips_timer);
+  }
+  set_compare(read_count());
   return IF_FILTERED;
 }
 
@@ -50,26 +86,58 @@ static bintime_t mips_timer_gettime(timer_t *tm) {
   return bt;
 }
 
+static int mips_timer_start(timer_t *tm, unsigned flags, const bintime_t start,
+                            const bintime_t period) {
+  assert(flags & TMF_ONESHOT);
+
+  SCOPED_INTR_DISABLED();
+  uint64_t now = read_count();
+  deadline = now + bintime_mul(start, CPU_FREQ).sec;
+  armed = true;
+  set_compare(now);
+  return 0;
+}
+
+static int mips_timer_stop(timer_t *tm) {
+  SCOPED_INTR_DISABLED();
+  armed = false;
+  set_compare(read_count());
+  return 0;
+}
+
 static timer_t mips_timer = {
   .tm_name = "mips-cpu-timer",
-  .tm_flags = 0,
+  .tm_flags = TMF_ONESHOT,
   .tm_frequency = CPU_FREQ,
+  .tm_start = mips_timer_start,
+  .tm_stop = mips_timer_stop,
   .tm_gettime = mips_timer_gettime,
 };
 
-static inline timeval_t ticks2tv(uint64_t ticks) {
+timeval_t cputicks2tv(cputicks_t ticks) {
   ticks /= (uint64_t)TICKS_PER_US;
   return (timeval_t){.tv_sec = ticks / 1000000LL, .tv_usec = ticks % 1000000LL};
 }
 
+unsigned cputicks2us(cputicks_t ticks) {
+  /* Intervals measured on hot paths are short, so avoid 64-bit division. */
+  if (ticks <= UINT32_MAX)
+    return (uint32_t)ticks / TICKS_PER_US;
+  return min(ticks / TICKS_PER_US, (uint64_t)UINT_MAX);
+}
+
+cputicks_t getcputicks(void) {
+  return read_count();
+}
+
 timeval_t getcputime(void) {
-  return ticks2tv(read_count());
+  return cputicks2tv(read_count());
 }
 
 void mips_timer_init(void) {
   /* Reset cpu timer. */
   mips32_set_c0(C0_COUNT, 0);
-  mips32_set_c0(C0_COMPARE, 0);
+  mips32_set_c0(C0_COMPARE, COMPARE_GUARD);
 
   /* Let's permanently enable interrupt handler, as we need to generate
    * interrupt to register counter overflow to correctly maintain time. */
@@ -78,3 +146,8 @@ void mips_timer_init(void) {
   tm_register(&mips_timer);
   tm_select(&mips_timer);
 }
+
+void mips_timer_cpu_init(void) {
+  mips32_set_c0(C0_COMPARE, mips32_get_c0(C0_COUNT) + TICKS_PER_MS);
+  mips32_bs_c0(C0_STATUS, SR_IM0 << MIPS_HWINT5);
+}
@@ -2,6 +2,7 @@
 #include <mips/pmap.h>
 #include <mips/tlb.h>
 #include <interrupt.h>
+#include <pcpu.h>
 
 #define mips32_getasid() (mips32_getentryhi() & PTE_ASID_MASK)
 #define mips32_setasid(v) mips32_setentryhi((v)&PTE_ASID_MASK)
@@ -49,6 +50,9 @@ static inline void _load_tlb_entry(tlbentry_t *e) {
   mips32_setentryhi(hi);
   mips32_setentrylo0(lo0);
   mips32_setentrylo1(lo1);
+  /* Entries written by the kernel are always 4KiB, while PageMask could have
+   * been left modified by TLB refill handler or tlbr instruction. */
+  mips32_setpagemask(0);
 }
 
 static inline void _tlb_write(unsigned i, tlbentry_t *e) {
@@ -91,11 +95,23 @@ void tlb_init(void) {
   if (tlb_size() == 0)
     panic("No TLB detected!");
 
-  tlb_invalidate_all();
+  /* Processor is brought up with interrupts disabled and without pcpu
+   * structure mapped yet, hence low-level functions have to be used. */
+  for (unsigned i = 0; i < tlb_size(); i++)
+    _tlb_invalidate(i);
   /* We're not going to use C0_CONTEXT so set it to zero. */
   mips32_setcontext(0);
-  /* First wired TLB entry is shared between kernel-PDE and user-PDE. */
-  mips32_setwired(1);
+  /* Wired TLB entries: the first one is shared between kernel-PDE and user-PDE,
+   * next maps pcpu structure and the rest backs kmap window. */
+  mips32_setwired(TLB_NWIRED);
+}
+
+void pcpu_md_init(pcpu_t *pc) {
+  paddr_t pa = MIPS_KSEG0_TO_PHYS(pc);
+  tlbentry_t e = {.hi = PTE_VPN2(PCPU_VADDR),
+                  .lo0 = PTE_PFN(pa) | PTE_VALID | PTE_DIRTY | PTE_GLOBAL,
+                  .lo1 = PTE_GLOBAL};
+  _tlb_write(TLB_WIRED_PCPU, &e);
 }
 
 void tlb_invalidate(tlbhi_t hi) {
@@ -11,6 +11,7 @@ N_THOROUGH = 100
 TIMEOUT = 20
 RETRIES_MAX = 5
 REPEAT = 5
+SMP = 2
 
 GDB_PORT_BASE = 9100
 
@@ -55,15 +56,16 @@ def gdb_inspect(interactive):
         gdb.interact()
 
 
-def test_seed(seed, interactive=True, repeat=1, retry=0):
+def test_seed(seed, interactive=True, repeat=1, retry=0, smp=1):
     if retry == RETRIES_MAX:
         print("Maximum retries reached, still not output received. "
               "Test inconclusive.")
         sys.exit(1)
 
-    print("Testing seed %d..." % seed)
+    print("Testing seed %d on %d CPUs..." % (seed, smp))
     child = pexpect.spawn('./launch',
-                          ['-t', 'test=all', 'klog-quiet=1', 'seed=%d' % seed,
+                          ['--smp', str(smp), '-t', 'test=all', 'klog-quiet=1',
+                           'swapsize=4', 'seed=%d' % seed,
                            'repeat=%d' % repeat])
     index = child.expect_exact(
         ['[TEST PASSED]', '[TEST FAILED]', pexpect.EOF, pexpect.TIMEOUT],
@@ -90,7 +92,7 @@ def test_seed(seed, interactive=True, repeat=1, retry=0):
         print("EOF reached without success report. This may indicate "
               "a problem with the testing framework or QEMU. "
               "Retrying (%d)..." % (retry + 1))
-        test_seed(seed, interactive, repeat, retry + 1)
+        test_seed(seed, interactive, repeat, retry + 1, smp)
     elif index == 3:
         print("Timeout reached.\n")
         message = safe_decode(child.buffer)
@@ -99,7 +101,7 @@ def test_seed(seed, interactive=True, repeat=1, retry=0):
             print("It looks like kernel did not even start within the time "
                   "limit. Retrying (%d)..." % (retry + 1))
             child.terminate(True)
-            test_seed(seed, interactive, repeat, retry + 1)
+            test_seed(seed, interactive, repeat, retry + 1, smp)
         else:
             gdb_inspect(interactive)
             print("No test result reported within timeout. Unable to verify "
@@ -130,6 +132,8 @@ if __name__ == '__main__':
 
     # Run tests in alphabetic order
     test_seed(0, interactive)
+    # Some tests (e.g. user_smp_spread) are meaningful on SMP machines only.
+    test_seed(0, interactive, smp=SMP)
     # Run infinitely many tests, until some problem is found.
     if args.infinite:
         while True:
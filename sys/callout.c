@@ -148,6 +148,24 @@ void callout_process(systime_t time) {
   ci.last = time;
 }
 
+bool callout_next(systime_t *timep) {
+  SCOPED_SPINLOCK(&ci.lock);
+
+  bool found = false;
+
+  for (int i = 0; i < CALLOUT_BUCKETS; i++) {
+    callout_t *elem;
+    TAILQ_FOREACH (elem, ci_list(i), c_link) {
+      if (!found || elem->c_time < *timep) {
+        *timep = elem->c_time;
+        found = true;
+      }
+    }
+  }
+
+  return found;
+}
+
 bool callout_drain(callout_t *handle) {
   /* A callout may be in active state only in callout_process,
    * which is called in bottom half (with interrupts disabled),
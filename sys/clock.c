@@ -3,12 +3,15 @@
 #include <sched.h>
 #include <klog.h>
 #include <timer.h>
+#include <interrupt.h>
 #include <sysinit.h>
 
 #define SYSTIME_FREQ 1000 /* 1[tick] = 1[ms] */
 
 static systime_t now = 0;
 static timer_t *clock = NULL;
+static timer_t *alarm = NULL; /* wakes up idle processor for next callout */
+static bool tickless = false;
 
 systime_t getsystime(void) {
   return now;
@@ -20,15 +23,60 @@ static void clock_cb(timer_t *tm, void *arg) {
   sched_clock();
 }
 
+/* Interrupt has woken up the processor, clock_idle_leave does the rest. */
+static void alarm_cb(timer_t *tm, void *arg) {
+}
+
+void clock_idle_enter(void) {
+  assert(intr_disabled());
+
+  if (alarm == NULL || tickless)
+    return;
+
+  if (tm_stop(clock))
+    return;
+
+  systime_t next;
+  if (callout_next(&next)) {
+    systime_t delta = (next > now) ? next - now : 0;
+    tm_start(alarm, TMF_ONESHOT, bintime_mul(HZ2BT(SYSTIME_FREQ), delta),
+             (bintime_t){});
+  }
+
+  tickless = true;
+}
+
+void clock_idle_leave(void) {
+  assert(intr_disabled());
+
+  if (!tickless)
+    return;
+
+  tm_stop(alarm);
+  if (tm_start(clock, TMF_PERIODIC, (bintime_t){}, HZ2BT(SYSTIME_FREQ)))
+    panic("Failed to restart system clock!");
+  tickless = false;
+
+  /* Catch up with callouts that expired while clock was stopped. */
+  now = bintime_mul(getbintime(), SYSTIME_FREQ).sec;
+  callout_process(now);
+}
+
 static void clock_init(void) {
   clock = tm_reserve(NULL, TMF_PERIODIC);
   if (clock == NULL)
     panic("Missing suitable timer for maintenance of system clock!");
   tm_init(clock, clock_cb, NULL);
-  if (tm_start(clock, TMF_PERIODIC | TMF_TIMESOURCE, (bintime_t){},
-               HZ2BT(SYSTIME_FREQ)))
+  if (tm_start(clock, TMF_PERIODIC, (bintime_t){}, HZ2BT(SYSTIME_FREQ)))
     panic("Failed to start system clock!");
   klog("System clock uses \'%s\' hardware timer.", clock->tm_name);
+
+  /* Without one-shot timer the clock cannot be stopped when system is idle. */
+  alarm = tm_reserve(NULL, TMF_ONESHOT);
+  if (alarm == NULL)
+    return;
+  tm_init(alarm, alarm_cb, NULL);
+  klog("Idle processor is woken up by \'%s\' hardware timer.", alarm->tm_name);
 }
 
 SYSINIT_ADD(clock, clock_init, DEPS("sched", "callout", "pit"));
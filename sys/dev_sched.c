@@ -0,0 +1,97 @@
+#include <vnode.h>
+#include <mount.h>
+#include <devfs.h>
+#include <errno.h>
+#include <uio.h>
+#include <stdc.h>
+#include <sched.h>
+#include <runq.h>
+#include <linker_set.h>
+
+/*
+ * Reading /dev/schedlat gives wakeup-to-run latency histograms. Each priority
+ * band that has seen any wakeups is described by three lines:
+ *
+ *   band <first prio>-<last prio> count <n> max <latency>
+ *   latency <bound>:<n> ...
+ *   depth <bound>:<n> ...
+ *
+ * where <n> is the number of samples less than <bound> but not less than the
+ * previous one. Latencies are in microseconds. Writing anything to the file
+ * clears the histograms.
+ */
+
+/* Longest possible output: a header line per band, then histogram lines made of
+ * a name and up to nbuckets entries " <bound>:<n>" of two 32-bit numbers. */
+#define SCHEDLAT_NUM_MAX 10 /* digits in UINT32_MAX */
+#define SCHEDLAT_HDR_MAX (sizeof("band - count  max \n") + 4 * SCHEDLAT_NUM_MAX)
+#define SCHEDLAT_HIST_MAX(nbuckets)                                            \
+  (sizeof("latency\n") + (nbuckets) * (3 + 2 * SCHEDLAT_NUM_MAX))
+#define SCHEDLAT_BUF_MAX                                                       \
+  (SCHED_LAT_BANDS *                                                           \
+   (SCHEDLAT_HDR_MAX + SCHEDLAT_HIST_MAX(SCHED_LAT_BUCKETS) +                  \
+    SCHEDLAT_HIST_MAX(SCHED_DEPTH_BUCKETS)))
+
+/* Guarded by the big kernel lock, as are histograms themselves. */
+static char schedlat_buf[SCHEDLAT_BUF_MAX];
+static sched_lat_band_t schedlat_bands[SCHED_LAT_BANDS];
+
+/* Appends non-empty buckets of a histogram to the buffer. */
+static size_t schedlat_hist(size_t len, const char *name, unsigned *hist,
+                            unsigned nbuckets) {
+  len += snprintf(schedlat_buf + len, SCHEDLAT_BUF_MAX - len, "%s", name);
+
+  for (unsigned i = 0; i < nbuckets; i++) {
+    if (hist[i] == 0)
+      continue;
+    if (i == nbuckets - 1)
+      len += snprintf(schedlat_buf + len, SCHEDLAT_BUF_MAX - len, " inf:%u",
+                      hist[i]);
+    else
+      len += snprintf(schedlat_buf + len, SCHEDLAT_BUF_MAX - len, " %u:%u",
+                      1U << i, hist[i]);
+  }
+
+  len += snprintf(schedlat_buf + len, SCHEDLAT_BUF_MAX - len, "\n");
+  return len;
+}
+
+static int dev_schedlat_read(vnode_t *v, uio_t *uio) {
+  const unsigned nprios = RQ_NQS * RQ_PPQ / SCHED_LAT_BANDS;
+  size_t len = 0;
+
+  sched_lat_get(schedlat_bands);
+
+  for (unsigned i = 0; i < SCHED_LAT_BANDS; i++) {
+    sched_lat_band_t *band = &schedlat_bands[i];
+    if (band->count == 0)
+      continue;
+    len += snprintf(schedlat_buf + len, SCHEDLAT_BUF_MAX - len,
+                    "band %u-%u count %u max %u\n", i * nprios,
+                    (i + 1) * nprios - 1, band->count, band->max_latency);
+    len = schedlat_hist(len, "latency", band->latency, SCHED_LAT_BUCKETS);
+    len = schedlat_hist(len, "depth", band->depth, SCHED_DEPTH_BUCKETS);
+  }
+
+  assert(len < SCHEDLAT_BUF_MAX);
+  if (uio->uio_offset >= (off_t)len)
+    return 0;
+  return uiomove_frombuf(schedlat_buf, len, uio);
+}
+
+static int dev_schedlat_write(vnode_t *v, uio_t *uio) {
+  sched_lat_reset();
+  uio->uio_resid = 0;
+  return 0;
+}
+
+static vnodeops_t dev_schedlat_vnodeops = {.v_open = vnode_open_generic,
+                                           .v_read = dev_schedlat_read,
+                                           .v_write = dev_schedlat_write};
+
+static void init_dev_schedlat(void) {
+  vnodeops_init(&dev_schedlat_vnodeops);
+  devfs_makedev(NULL, "schedlat", &dev_schedlat_vnodeops, NULL);
+}
+
+SET_ENTRY(devfs_init, init_dev_schedlat);
@@ -3,6 +3,7 @@
 #include <thread.h>
 #include <sched.h>
 #include <signal.h>
+#include <proc.h>
 
 void exc_before_leave(exc_frame_t *kframe) {
   thread_t *td = thread_self();
@@ -22,6 +23,7 @@ void exc_before_leave(exc_frame_t *kframe) {
 
   /* First thing after switching to a thread: Process pending signals. */
   if (td->td_flags & TDF_NEEDSIGCHK) {
+    SCOPED_MTX_LOCK(&td->td_proc->p_lock);
     SCOPED_MTX_LOCK(&td->td_lock);
     int sig;
     while ((sig = sig_check(td)) != 0)
@@ -16,6 +16,9 @@
 #include <vnode.h>
 #include <proc.h>
 
+/* Initial size of user stack segment. */
+#define USTACK_INITIAL (64 * 1024)
+
 int do_exec(const exec_args_t *args) {
   thread_t *td = thread_self();
 
@@ -204,33 +207,31 @@ int do_exec(const exec_args_t *args) {
           bzero((uint8_t *)start + ph->p_filesz, ph->p_memsz - ph->p_filesz);
         /* Apply correct permissions */
         vm_prot_t prot = VM_PROT_NONE;
-        if (ph->p_flags | PF_R)
+        if (ph->p_flags & PF_R)
           prot |= VM_PROT_READ;
-        if (ph->p_flags | PF_W)
+        if (ph->p_flags & PF_W)
           prot |= VM_PROT_WRITE;
-        if (ph->p_flags | PF_X)
+        if (ph->p_flags & PF_X)
           prot |= VM_PROT_EXEC;
-        /* Note: vm_map_protect is not yet implemented, so
-         * this will have no effect as of now */
         vm_map_protect(vmap, start, end, prot);
     }
   }
 
-  /* Create a stack segment. As for now, the stack size is fixed and
-   * will not grow on-demand. Also, the stack info should be saved
-   * into the thread structure.
+  /* Create a stack segment. Initially it's small, but it grows on-demand
+   * downwards, up to the limit set by RLIMIT_STACK (see vm_page_fault).
+   * Also, the stack info should be saved into the thread structure.
    * Generally, the stack should begin at a high address (0x80000000),
    * excluding env vars and arguments, but I've temporarly moved it
    * a bit lower so that it is easier to spot invalid memory access
    * when the stack underflows.
    */
   vaddr_t stack_bottom = 0x7f800000;
-  vaddr_t stack_top = 0x7f000000; /* stack size is 8 MiB */
+  vaddr_t stack_top = stack_bottom - USTACK_INITIAL;
 
   vm_object_t *stack_obj = vm_object_alloc(VM_ANONYMOUS);
   vm_segment_t *stack_seg = vm_segment_alloc(stack_obj, stack_top, stack_bottom,
                                              VM_PROT_READ | VM_PROT_WRITE);
-  error = vm_map_insert(vmap, stack_seg, VM_FIXED);
+  error = vm_map_insert(vmap, stack_seg, VM_FIXED | VM_STACK);
   /* TODO: What if this area overlaps with a loaded segment? */
   assert(error == 0);
 
@@ -41,12 +41,15 @@ int do_fork(void) {
   newtd->td_wchan = NULL;
   newtd->td_waitpt = NULL;
 
-  newtd->td_prio = td->td_prio;
-
   /* Now, prepare a new process. */
   assert(td->td_proc);
   proc_t *proc = proc_create(newtd, td->td_proc);
 
+  /* Scheduling parameters are inherited, overriding those of a new process. */
+  newtd->td_prio = td->td_prio;
+  newtd->td_base_prio = td->td_base_prio;
+  newtd->td_policy = td->td_policy;
+
   /* Clone the entire process memory space. */
   proc->p_uspace = vm_map_clone(td->td_proc->p_uspace);
 
@@ -28,6 +28,15 @@ void intr_enable(void) {
     mips_intr_enable();
 }
 
+void intr_wait(void) {
+  assert(intr_disabled());
+  thread_t *td = thread_self();
+  assert(td->td_idnest == 1);
+  td->td_idnest = 0;
+  mips_intr_wait();
+  td->td_idnest = 1;
+}
+
 void intr_chain_register(intr_chain_t *ic) {
   WITH_MTX_LOCK (&all_ichains_mtx)
     TAILQ_INSERT_TAIL(&all_ichains_list, ic, ic_list);
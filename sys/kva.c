@@ -0,0 +1,48 @@
+#define KL_LOG KL_VM
+#include <klog.h>
+#include <kva.h>
+#include <pmap.h>
+#include <vmem.h>
+#include <mips/pmap.h>
+
+/* Single pages are mapped most often, so keep quantum caches for them and
+ * for a few more sizes used by kmalloc arenas. */
+#define KVA_QCACHE_MAX (4 * PAGESIZE)
+
+static vmem_t kva_arena;
+
+void kva_init(void) {
+  vmem_init(&kva_arena, "kva", PAGESIZE, KVA_QCACHE_MAX);
+  if (vmem_add(&kva_arena, PMAP_KVA_BEGIN, PMAP_KVA_END - PMAP_KVA_BEGIN))
+    panic("cannot initialize kernel virtual address space");
+}
+
+void *kva_alloc(size_t size) {
+  vmem_addr_t va;
+  if (vmem_alloc(&kva_arena, size, &va))
+    return NULL;
+  return (void *)va;
+}
+
+void kva_free(void *va, size_t size) {
+  vmem_free(&kva_arena, (vmem_addr_t)va, size);
+}
+
+void *kva_map_page(vm_page_t *pg) {
+  if (!PG_HIGHMEM(pg))
+    return PG_KSEG0_ADDR(pg);
+
+  void *va = kva_alloc(PG_SIZE(pg));
+  if (va == NULL)
+    return NULL;
+  pmap_enter(get_kernel_pmap(), (vaddr_t)va, pg, VM_PROT_READ | VM_PROT_WRITE);
+  return va;
+}
+
+void kva_unmap_page(void *va, vm_page_t *pg) {
+  if (!PG_HIGHMEM(pg))
+    return;
+
+  pmap_remove(get_kernel_pmap(), (vaddr_t)va, (vaddr_t)va + PG_SIZE(pg));
+  kva_free(va, PG_SIZE(pg));
+}
@@ -1,6 +1,7 @@
 #define KL_LOG KL_KMEM
 #include <klog.h>
 #include <stdc.h>
+#include <kva.h>
 #include <mutex.h>
 #include <malloc.h>
 #include <physmem.h>
@@ -114,9 +115,19 @@ static void kmalloc_add_arena(kmem_pool_t *mp, vaddr_t start,
   add_free_memory_block(ma, mb, block_size);
 }
 
-static void kmalloc_add_pages(kmem_pool_t *mp, unsigned pages) {
-  vm_page_t *pg = pm_alloc(pages);
-  kmalloc_add_arena(mp, (vaddr_t)PG_KSEG0_ADDR(pg), PG_SIZE(pg));
+static bool kmalloc_add_pages(kmem_pool_t *mp, unsigned pages) {
+  vm_page_t *pg = pm_alloc_high(pages);
+  if (pg == NULL)
+    return false;
+
+  void *va = kva_map_page(pg);
+  if (va == NULL) {
+    pm_free(pg);
+    return false;
+  }
+
+  kmalloc_add_arena(mp, (vaddr_t)va, PG_SIZE(pg));
+  return true;
 }
 
 static mem_block_t *find_entry(struct mb_list *mb_list, size_t total_size) {
@@ -175,8 +186,7 @@ void *kmalloc(kmem_pool_t *mp, size_t size, unsigned flags) {
   if (flags & M_NOWAIT)
     return NULL;
 
-  if (mp->mp_pages_used < mp->mp_pages_max) {
-    kmalloc_add_pages(mp, 1);
+  if (mp->mp_pages_used < mp->mp_pages_max && kmalloc_add_pages(mp, 1)) {
     mp->mp_pages_used++;
     return kmalloc(mp, size, flags);
   }
@@ -216,7 +226,8 @@ static void kmem_init(kmem_pool_t *mp) {
   mp->mp_magic = MB_MAGIC;
   TAILQ_INIT(&mp->mp_arena);
   mtx_init(&mp->mp_lock, MTX_RECURSE);
-  kmalloc_add_pages(mp, mp->mp_pages_used);
+  if (!kmalloc_add_pages(mp, mp->mp_pages_used))
+    panic("no memory for '%s' kmem", mp->mp_desc);
   klog("initialized '%s' kmem at %p ", mp->mp_desc, mp);
 }
 
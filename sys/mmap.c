@@ -7,6 +7,7 @@
 #include <vm_object.h>
 #include <mutex.h>
 #include <proc.h>
+#include <systm.h>
 
 int do_mmap(vaddr_t *addr_p, size_t length, vm_prot_t prot, vm_flags_t flags) {
   thread_t *td = thread_self();
@@ -52,3 +53,116 @@ int do_mmap(vaddr_t *addr_p, size_t length, vm_prot_t prot, vm_flags_t flags) {
   *addr_p = start;
   return 0;
 }
+
+/* Checks if [addr, addr + length) is a valid range within user space. */
+static int check_user_range(vm_map_t *vmap, vaddr_t addr, size_t length) {
+  if (!is_aligned(addr, PAGESIZE))
+    return -EINVAL;
+
+  if (length == 0)
+    return -EINVAL;
+
+  if (!vm_map_in_range(vmap, addr) ||
+      !vm_map_in_range(vmap, addr + length - 1))
+    return -EINVAL;
+
+  return 0;
+}
+
+int do_munmap(vaddr_t addr, size_t length) {
+  thread_t *td = thread_self();
+  assert(td->td_proc != NULL);
+  proc_t *p = td->td_proc;
+  vm_map_t *vmap = p->p_uspace;
+  assert(vmap != NULL);
+
+  length = roundup(length, PAGESIZE);
+
+  int error = check_user_range(vmap, addr, length);
+  if (error)
+    return error;
+
+  /* Segment backing sbrk is referenced by process structure. */
+  if (p->p_sbrk) {
+    vaddr_t sbrk_start, sbrk_end;
+    vm_segment_range(p->p_sbrk, &sbrk_start, &sbrk_end);
+    if (addr < sbrk_end && sbrk_start < addr + length)
+      return -EINVAL;
+  }
+
+  klog("Remove mappings from %p, length: %u", (void *)addr, length);
+
+  return vm_map_remove(vmap, addr, addr + length);
+}
+
+int do_mprotect(vaddr_t addr, size_t length, vm_prot_t prot) {
+  thread_t *td = thread_self();
+  assert(td->td_proc != NULL);
+  vm_map_t *vmap = td->td_proc->p_uspace;
+  assert(vmap != NULL);
+
+  length = roundup(length, PAGESIZE);
+
+  int error = check_user_range(vmap, addr, length);
+  if (error)
+    return error;
+
+  if (prot & ~(VM_PROT_READ | VM_PROT_WRITE | VM_PROT_EXEC))
+    return -EINVAL;
+
+  klog("Change protection of %p, length: %u to %d", (void *)addr, length,
+       prot);
+
+  return vm_map_protect(vmap, addr, addr + length, prot);
+}
+
+int do_madvise(vaddr_t addr, size_t length, int advice) {
+  thread_t *td = thread_self();
+  assert(td->td_proc != NULL);
+  vm_map_t *vmap = td->td_proc->p_uspace;
+  assert(vmap != NULL);
+
+  length = roundup(length, PAGESIZE);
+
+  int error = check_user_range(vmap, addr, length);
+  if (error)
+    return error;
+
+  if (advice != MADV_NORMAL && advice != MADV_SEQUENTIAL &&
+      advice != MADV_WILLNEED && advice != MADV_DONTNEED)
+    return -EINVAL;
+
+  klog("Advise %d for %p, length: %u", advice, (void *)addr, length);
+
+  return vm_map_advise(vmap, addr, addr + length, advice);
+}
+
+/* Residency of that many pages is reported in one go. */
+#define MINCORE_CHUNK 64U
+
+int do_mincore(vaddr_t addr, size_t length, char *user_vec) {
+  thread_t *td = thread_self();
+  assert(td->td_proc != NULL);
+  vm_map_t *vmap = td->td_proc->p_uspace;
+  assert(vmap != NULL);
+
+  length = roundup(length, PAGESIZE);
+
+  int error = check_user_range(vmap, addr, length);
+  if (error)
+    return error;
+
+  uint8_t vec[MINCORE_CHUNK];
+
+  for (vaddr_t end = addr + length; addr < end;) {
+    size_t n = min((end - addr) / PAGESIZE, MINCORE_CHUNK);
+    if ((error = vm_map_resident(vmap, addr, addr + n * PAGESIZE, vec)))
+      return error;
+    if ((error = copyout(vec, user_vec, n)))
+      return error;
+    addr += n * PAGESIZE;
+    user_vec += n;
+  }
+
+  return 0;
+}
@@ -1,11 +1,23 @@
+#include <stdc.h>
 #include <thread.h>
 #include <pcpu.h>
 
-__wired_data pcpu_t _pcpu_data[1] = {{}};
+__wired_data pcpu_t _pcpu_data[MAXCPU];
 
-static thread_t *dummy =
-  &(thread_t){.td_name = "dummy thread", .td_tid = 0, .td_idnest = 1};
+/* Stand for curthread until processor switches to its first real thread. */
+static thread_t dummy_threads[MAXCPU];
 
-void pcpu_init(void) {
-  PCPU_SET(curthread, dummy);
+void pcpu_init(unsigned cpuid) {
+  assert(cpuid < MAXCPU);
+
+  pcpu_t *pc = &_pcpu_data[cpuid];
+  thread_t *dummy = &dummy_threads[cpuid];
+
+  strlcpy(dummy->td_name, "dummy thread", TD_NAME_MAX);
+  dummy->td_idnest = 1;
+
+  pc->cpuid = cpuid;
+  pc->curthread = dummy;
+  pc->running = true;
+  pcpu_md_init(pc);
 }
@@ -56,6 +56,8 @@ void pm_seg_init(pm_seg_t *seg, paddr_t start, paddr_t end, off_t offset) {
   assert(is_aligned(start, PAGESIZE));
   assert(is_aligned(end, PAGESIZE));
   assert(is_aligned(offset, PAGESIZE));
+  /* Segment must be either entirely below or entirely above KSEG0 limit. */
+  assert(end <= MIPS_PHYS_MASK + 1 || start > MIPS_PHYS_MASK);
 
   seg->start = start;
   seg->end = end;
@@ -224,12 +226,16 @@ static vm_page_t *pm_alloc_from_seg(pm_seg_t *seg, size_t npages) {
   }
 }
 
-vm_page_t *pm_alloc(size_t npages) {
-  assert((npages > 0) && powerof2(npages));
+static bool pm_seg_highmem(pm_seg_t *seg) {
+  return seg->start > MIPS_PHYS_MASK;
+}
 
+static vm_page_t *pm_alloc_from(size_t npages, bool highmem) {
   pm_seg_t *seg_it;
   TAILQ_FOREACH (seg_it, &seglist, segq) {
     vm_page_t *page;
+    if (pm_seg_highmem(seg_it) != highmem)
+      continue;
     if ((page = pm_alloc_from_seg(seg_it, npages))) {
       klog("pm_alloc {paddr:%lx size:%ld}", page->paddr, page->size);
       return page;
@@ -239,6 +245,19 @@ vm_page_t *pm_alloc(size_t npages) {
   return NULL;
 }
 
+vm_page_t *pm_alloc(size_t npages) {
+  assert((npages > 0) && powerof2(npages));
+
+  return pm_alloc_from(npages, false);
+}
+
+vm_page_t *pm_alloc_high(size_t npages) {
+  assert((npages > 0) && powerof2(npages));
+
+  vm_page_t *page = pm_alloc_from(npages, true);
+  return page ? page : pm_alloc_from(npages, false);
+}
+
 static void pm_free_from_seg(pm_seg_t *seg, vm_page_t *page) {
   if (page->pm_flags & PM_RESERVED)
     panic("trying to free reserved page: %p", (void *)page->paddr);
@@ -283,6 +302,114 @@ void pm_free(vm_page_t *page) {
   panic("page out of range: %p", (void *)page->paddr);
 }
 
+/* Moves all pages from @src to the end of @dst. */
+static void pm_list_append(pg_list_t *dst, pg_list_t *src) {
+  vm_page_t *pg;
+  while ((pg = TAILQ_FIRST(src))) {
+    TAILQ_REMOVE(src, pg, pageq);
+    TAILQ_INSERT_TAIL(dst, pg, pageq);
+  }
+}
+
+/* Sorts list of @n pages by physical address using merge sort. */
+static void pm_list_sort(pg_list_t *list, size_t n) {
+  if (n < 2)
+    return;
+
+  pg_list_t left, right;
+  TAILQ_INIT(&left);
+  TAILQ_INIT(&right);
+
+  for (size_t i = 0; i < n / 2; i++) {
+    vm_page_t *pg = TAILQ_FIRST(list);
+    TAILQ_REMOVE(list, pg, pageq);
+    TAILQ_INSERT_TAIL(&left, pg, pageq);
+  }
+  pm_list_append(&right, list);
+
+  pm_list_sort(&left, n / 2);
+  pm_list_sort(&right, n - n / 2);
+
+  vm_page_t *l, *r;
+  while ((l = TAILQ_FIRST(&left)) && (r = TAILQ_FIRST(&right))) {
+    pg_list_t *from = (l->paddr < r->paddr) ? &left : &right;
+    vm_page_t *pg = TAILQ_FIRST(from);
+    TAILQ_REMOVE(from, pg, pageq);
+    TAILQ_INSERT_TAIL(list, pg, pageq);
+  }
+  pm_list_append(list, &left);
+  pm_list_append(list, &right);
+}
+
+/* Returns pages [first, first + n) to buddy system as largest possible blocks
+ * aligned to their size. All pages must be allocated. */
+static unsigned pm_free_run(pm_seg_t *seg, vm_page_t *first, unsigned n) {
+  unsigned nblocks = 0;
+  while (n > 0) {
+    unsigned index = first - seg->pages;
+    unsigned order = index ? ctz(index) : PM_NQUEUES - 1;
+    unsigned size = 1 << min(PM_NQUEUES - 1, order);
+    while (size > n)
+      size /= 2;
+    first->size = size;
+    pm_free_from_seg(seg, first);
+    first += size;
+    n -= size;
+    nblocks++;
+  }
+  return nblocks;
+}
+
+void pm_free_list(pg_list_t *pages) {
+  size_t npages = 0;
+  vm_page_t *pg;
+  TAILQ_FOREACH (pg, pages, pageq)
+    npages++;
+
+  pm_list_sort(pages, npages);
+
+  pm_seg_t *seg = NULL;
+  unsigned nblocks = 0;
+
+  while ((pg = TAILQ_FIRST(pages))) {
+    if (seg == NULL || PG_START(pg) < seg->start || PG_END(pg) > seg->end) {
+      TAILQ_FOREACH (seg, &seglist, segq)
+        if (PG_START(pg) >= seg->start && PG_END(pg) <= seg->end)
+          break;
+      if (seg == NULL)
+        panic("page out of range: %p", (void *)pg->paddr);
+    }
+
+    /* Gather a run of physically contiguous pages within the segment. */
+    vm_page_t *first = pg, *last = pg;
+    do {
+      TAILQ_REMOVE(pages, pg, pageq);
+      for (unsigned i = 0; i < pg->size; i++) {
+        if (pg[i].pm_flags & PM_RESERVED)
+          panic("trying to free reserved page: %p", (void *)pg[i].paddr);
+        if (!(pg[i].pm_flags & PM_ALLOCATED))
+          panic("page is already free: %p", (void *)pg[i].paddr);
+      }
+      last = pg;
+      pg = TAILQ_FIRST(pages);
+    } while (pg && pg == last + last->size && PG_END(pg) <= seg->end);
+
+    nblocks += pm_free_run(seg, first, last + last->size - first);
+  }
+
+  klog("pm_free_list {pages:%ld blocks:%d}", npages, nblocks);
+}
+
+vm_page_t *pm_find_page(paddr_t pa) {
+  pm_seg_t *seg_it;
+
+  TAILQ_FOREACH (seg_it, &seglist, segq)
+    if (pa >= seg_it->start && pa < seg_it->end)
+      return &seg_it->pages[(pa - seg_it->start) / PAGESIZE];
+
+  return NULL;
+}
+
 vm_page_t *pm_split_alloc_page(vm_page_t *pg) {
   klog("pm_split {paddr:%lx size:%ld}\n", pg->paddr, pg->size);
 
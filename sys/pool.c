@@ -2,6 +2,7 @@
 #include <stdc.h>
 #include <vm.h>
 #include <physmem.h>
+#include <kva.h>
 #include <queue.h>
 #include <bitstring.h>
 #include <common.h>
@@ -75,8 +76,16 @@ static unsigned slab_index_of(pool_slab_t *slab, pool_item_t *item) {
 static pool_slab_t *add_slab(pool_t *pool) {
   debug("create_slab: pool = %p, pp_itemsize = %d", pool, pool->pp_itemsize);
 
-  vm_page_t *page = pm_alloc(1);
-  pool_slab_t *slab = PG_KSEG0_ADDR(page);
+  vm_page_t *page = pm_alloc_high(1);
+  if (page == NULL)
+    return NULL;
+
+  pool_slab_t *slab = kva_map_page(page);
+  if (slab == NULL) {
+    pm_free(page);
+    return NULL;
+  }
+
   slab->ph_state = ALIVE;
   slab->ph_page = page;
   slab->ph_nused = 0;
@@ -128,8 +137,10 @@ static void destroy_slab(pool_t *pool, pool_slab_t *slab) {
       pool->pp_dtor(curr_pi->pi_data);
   }
 
+  vm_page_t *page = slab->ph_page;
   slab->ph_state = DEAD;
-  pm_free(slab->ph_page);
+  kva_unmap_page(slab, page);
+  pm_free(page);
 }
 
 static void *slab_alloc(pool_slab_t *slab) {
@@ -172,6 +183,11 @@ void *pool_alloc(pool_t *pool, unsigned flags) {
     slab = LIST_FIRST(slabs);
   } else {
     slab = add_slab(pool);
+    if (slab == NULL) {
+      if (flags & PF_NOWAIT)
+        return NULL;
+      panic("memory exhausted in pool '%s'", pool->pp_desc);
+    }
     klog("pool_alloc: growing pool at %p", pool);
   }
 
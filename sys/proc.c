@@ -1,5 +1,6 @@
 #define KL_LOG KL_PROC
 #include <klog.h>
+#include <stdc.h>
 #include <proc.h>
 #include <pool.h>
 #include <thread.h>
@@ -11,40 +12,72 @@
 #include <signal.h>
 #include <sleepq.h>
 #include <sched.h>
+#include <resource.h>
+#include <time.h>
 
 static POOL_DEFINE(P_PROC, "proc", sizeof(proc_t));
 
 static mtx_t *all_proc_mtx = &MTX_INITIALIZER(MTX_DEF);
 
-/* proc_list, zombie_list and last_pid must be protected by all_proc_mtx */
+/* proc_list and zombie_list must be protected by all_proc_mtx */
 static proc_list_t proc_list = TAILQ_HEAD_INITIALIZER(proc_list);
 static proc_list_t zombie_list = TAILQ_HEAD_INITIALIZER(zombie_list);
 
+/* PIDs are allocated in increasing order, and the search for an unused one
+ * wraps around after PID_MAX. Hence a PID is not reused soon after its process
+ * has been reaped. PID 0 is given only to the first process. */
+#define PID_MAX 99999
+#define PIDHASH_SIZE 256 /* must be power of two */
+#define PIDHASH(pid) (&pidhash[(pid) & (PIDHASH_SIZE - 1)])
+
+/* pidhash and last_pid must be protected by pidhash_lock. Processes stay in
+ * the hash table until they're reaped, so that PIDs of zombies are not
+ * reused. */
+static mtx_t *pidhash_lock = &MTX_INITIALIZER(MTX_DEF);
+static LIST_HEAD(, proc) pidhash[PIDHASH_SIZE];
+static pid_t last_pid = -1;
+
 #define CHILDREN(p) (&(p)->p_children)
 
 proc_t *proc_self(void) {
   return thread_self()->td_proc;
 }
 
-#define NPROC 64 /* maximum number of processes */
+static proc_t *pid_lookup(pid_t pid) {
+  assert(mtx_owned(pidhash_lock));
 
-static bitstr_t pid_used[bitstr_size(NPROC)] = {0};
+  proc_t *p;
+  LIST_FOREACH (p, PIDHASH(pid), p_hash)
+    if (p->p_pid == pid)
+      return p;
+  return NULL;
+}
 
 static pid_t pid_alloc(void) {
-  assert(mtx_owned(all_proc_mtx));
+  assert(mtx_owned(pidhash_lock));
 
-  pid_t pid;
-  bit_ffc(pid_used, NPROC, &pid);
-  if (pid < 0)
-    panic("Out of PIDs!");
-  bit_set(pid_used, pid);
-  return pid;
+  pid_t pid = last_pid;
+  for (int i = 0; i < PID_MAX; i++) {
+    pid = (pid < PID_MAX) ? pid + 1 : 1;
+    if (pid_lookup(pid) == NULL)
+      return (last_pid = pid);
+  }
+  panic("Out of PIDs!");
 }
 
-static void pid_free(pid_t pid) {
-  assert(mtx_owned(all_proc_mtx));
+/* Default stack size limit. Stack segment grows on demand up to that size. */
+#define DFLSSIZ (32 * 1024 * 1024)
+
+static void proc_rlimit_init(proc_t *p, proc_t *parent) {
+  if (parent) {
+    SCOPED_MTX_LOCK(&parent->p_lock);
+    memcpy(p->p_rlimit, parent->p_rlimit, sizeof(p->p_rlimit));
+    return;
+  }
 
-  bit_clear(pid_used, (unsigned)pid);
+  for (int i = 0; i < RLIM_NLIMITS; i++)
+    p->p_rlimit[i] = (struct rlimit){RLIM_INFINITY, RLIM_INFINITY};
+  p->p_rlimit[RLIMIT_STACK].rlim_cur = DFLSSIZ;
 }
 
 proc_t *proc_create(thread_t *td, proc_t *parent) {
@@ -55,12 +88,22 @@ proc_t *proc_create(thread_t *td, proc_t *parent) {
   p->p_thread = td;
   p->p_parent = parent;
   TAILQ_INIT(CHILDREN(p));
+  proc_rlimit_init(p, parent);
 
   WITH_MTX_LOCK (&td->td_lock)
     td->td_proc = p;
 
-  WITH_MTX_LOCK (all_proc_mtx) {
+  /* Kernel thread becomes a user one, so it must give up kernel priority. */
+  WITH_SPINLOCK(td->td_spin) {
+    sched_set_prio(td, 0);
+  }
+
+  WITH_MTX_LOCK (pidhash_lock) {
     p->p_pid = pid_alloc();
+    LIST_INSERT_HEAD(PIDHASH(p->p_pid), p, p_hash);
+  }
+
+  WITH_MTX_LOCK (all_proc_mtx) {
     TAILQ_INSERT_TAIL(&proc_list, p, p_all);
     if (parent)
       TAILQ_INSERT_TAIL(CHILDREN(parent), p, p_child);
@@ -72,14 +115,16 @@ proc_t *proc_create(thread_t *td, proc_t *parent) {
 }
 
 proc_t *proc_find(pid_t pid) {
-  SCOPED_MTX_LOCK(all_proc_mtx);
+  SCOPED_MTX_LOCK(pidhash_lock);
 
-  proc_t *p = NULL;
-  TAILQ_FOREACH (p, &proc_list, p_all) {
-    mtx_lock(&p->p_lock);
-    if (p->p_pid == pid)
-      break;
+  proc_t *p = pid_lookup(pid);
+  if (p == NULL)
+    return NULL;
+
+  mtx_lock(&p->p_lock);
+  if (p->p_state == PS_ZOMBIE) {
     mtx_unlock(&p->p_lock);
+    return NULL;
   }
   return p;
 }
@@ -96,7 +141,9 @@ static void proc_reap(proc_t *p) {
     TAILQ_REMOVE(CHILDREN(p->p_parent), p, p_child);
   TAILQ_REMOVE(&zombie_list, p, p_zombie);
 
-  pid_free(p->p_pid);
+  WITH_MTX_LOCK (pidhash_lock)
+    LIST_REMOVE(p, p_hash);
+
   pool_free(P_PROC, p);
 }
 
@@ -151,10 +198,8 @@ noreturn void proc_exit(int exitstatus) {
 
     cv_broadcast(&parent->p_waitcv);
 
-    if (parent->p_sigactions[SIGCHLD].sa_handler != SIG_IGN) {
-      /* sig_send must be called with target process lock not acquired. */
+    WITH_MTX_LOCK (&parent->p_lock)
       sig_send(parent, SIGCHLD);
-    }
 
     /* Turn the process into a zombie. */
     WITH_MTX_LOCK (&p->p_lock)
@@ -223,3 +268,47 @@ int do_waitpid(pid_t pid, int *status, int options) {
 
   __unreachable();
 }
+
+int proc_getrusage(proc_t *p, int who, struct rusage *ru) {
+  /* Children resource usage is not accumulated yet. */
+  if (who != RUSAGE_SELF)
+    return -EINVAL;
+
+  bzero(ru, sizeof(struct rusage));
+
+  SCOPED_MTX_LOCK(&p->p_lock);
+
+  thread_t *td = p->p_thread;
+  if (td) {
+    cputicks_t rtime = td->td_rtime;
+    /* Time of current slice is accounted only on context switch. */
+    if (td == thread_self())
+      rtime += getcputicks() - td->td_last_rtime;
+    ru->ru_utime = cputicks2tv(rtime);
+  }
+  ru->ru_minflt = p->p_minflt;
+  return 0;
+}
+
+int proc_getrlimit(proc_t *p, int resource, struct rlimit *rlp) {
+  if (resource < 0 || resource >= RLIM_NLIMITS)
+    return -EINVAL;
+
+  SCOPED_MTX_LOCK(&p->p_lock);
+  *rlp = p->p_rlimit[resource];
+  return 0;
+}
+
+int proc_setrlimit(proc_t *p, int resource, const struct rlimit *rlp) {
+  if (resource < 0 || resource >= RLIM_NLIMITS)
+    return -EINVAL;
+
+  if (rlp->rlim_cur > rlp->rlim_max)
+    return -EINVAL;
+
+  SCOPED_MTX_LOCK(&p->p_lock);
+  if (rlp->rlim_max > p->p_rlimit[resource].rlim_max)
+    return -EPERM;
+  p->p_rlimit[resource] = *rlp;
+  return 0;
+}
@@ -3,6 +3,9 @@
 #include <thread.h>
 #include <runq.h>
 
+#define RQB_WORD(idx) ((idx) / RQB_BPW)
+#define RQB_BIT(idx) (1U << ((idx) % RQB_BPW))
+
 void runq_init(runq_t *rq) {
   memset(rq, 0, sizeof(*rq));
 
@@ -13,15 +16,28 @@ void runq_init(runq_t *rq) {
 void runq_add(runq_t *rq, thread_t *td) {
   unsigned prio = td->td_prio / RQ_PPQ;
   TAILQ_INSERT_TAIL(&rq->rq_queues[prio], td, td_runq);
+  rq->rq_status[RQB_WORD(prio)] |= RQB_BIT(prio);
+  rq->rq_count++;
+}
+
+void runq_add_head(runq_t *rq, thread_t *td) {
+  unsigned prio = td->td_prio / RQ_PPQ;
+  TAILQ_INSERT_HEAD(&rq->rq_queues[prio], td, td_runq);
+  rq->rq_status[RQB_WORD(prio)] |= RQB_BIT(prio);
+  rq->rq_count++;
 }
 
 thread_t *runq_choose(runq_t *rq) {
-  for (int i = RQ_NQS - 1; i >= 0; i--) {
-    struct rq_head *head = &rq->rq_queues[i];
-    thread_t *td = TAILQ_FIRST(head);
+  /* Highest non-empty queue is given by the most significant bit set. */
+  for (int i = RQB_LEN - 1; i >= 0; i--) {
+    uint32_t status = rq->rq_status[i];
+    if (status == 0)
+      continue;
 
-    if (td)
-      return td;
+    unsigned prio = i * RQB_BPW + (RQB_BPW - 1 - clz(status));
+    thread_t *td = TAILQ_FIRST(&rq->rq_queues[prio]);
+    assert(td != NULL);
+    return td;
   }
 
   return NULL;
@@ -30,4 +46,15 @@ thread_t *runq_choose(runq_t *rq) {
 void runq_remove(runq_t *rq, thread_t *td) {
   unsigned prio = td->td_prio / RQ_PPQ;
   TAILQ_REMOVE(&rq->rq_queues[prio], td, td_runq);
+  rq->rq_count--;
+  if (TAILQ_EMPTY(&rq->rq_queues[prio]))
+    rq->rq_status[RQB_WORD(prio)] &= ~RQB_BIT(prio);
+}
+
+bool runq_empty(runq_t *rq) {
+  volatile uint32_t *status = rq->rq_status;
+  for (unsigned i = 0; i < RQB_LEN; i++)
+    if (status[i])
+      return false;
+  return true;
 }
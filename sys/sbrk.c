@@ -44,13 +44,11 @@ vaddr_t sbrk_resize(proc_t *p, intptr_t increment) {
   if (new_end < sbrk_start)
     return -EINVAL;
 
-  /* TODO: Shrinking sbrk is impossible, because it requires unmapping pages,
-   * which is not yet implemented! */
-  if (new_end < last_end)
-    return -ENOTSUP;
+  /* Segment never shrinks below its initial size of one page. */
+  vaddr_t seg_end = max(roundup(new_end, PAGESIZE), sbrk_start + PAGESIZE);
 
-  /* Expand segment break! */
-  if (vm_map_resize(p->p_uspace, p->p_sbrk, roundup(new_end, PAGESIZE)) != 0)
+  /* Move segment break! Pages beyond new end are released on shrink. */
+  if (vm_map_resize(p->p_uspace, p->p_sbrk, seg_end) != 0)
     return -ENOMEM; /* Segment expansion failed. */
 
   p->p_sbrk_end = new_end;
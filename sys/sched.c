@@ -1,6 +1,7 @@
 #define KL_LOG KL_SCHED
 #include <klog.h>
 #include <stdc.h>
+#include <errno.h>
 #include <sched.h>
 #include <runq.h>
 #include <context.h>
@@ -10,16 +11,152 @@
 #include <interrupt.h>
 #include <mutex.h>
 #include <pcpu.h>
+#include <pmap.h>
+#include <smp.h>
 #include <sysinit.h>
 #include <turnstile.h>
 
-static runq_t runq;
 static bool sched_active = false;
 
-#define SLICE 10
+/* Slice length in clock ticks ranges from SLICE_MIN for interactive threads
+ * to SLICE_MAX for CPU-bound ones. */
+#define SLICE_MIN 4
+#define SLICE_MAX 20
+
+/* Slice length of SCHED_RR threads. SCHED_FIFO ones are never sliced. */
+#define SLICE_RR 10
+
+/*
+ * Interactivity score, as in FreeBSD ULE scheduler, ranges from 0 for threads
+ * that mostly sleep to INTERACT_MAX for threads that never do. It's computed
+ * from run and sleep times of last INTERACT_HISTORY microseconds or so.
+ * User threads get up to INTERACT_BAND priorities above their base priority,
+ * the more interactive they are, but never leave user priority range.
+ */
+#define INTERACT_MAX 100
+#define INTERACT_HALF (INTERACT_MAX / 2)
+#define INTERACT_HISTORY 5000000
+#define INTERACT_BAND (8 * RQ_PPQ)
+#define PRIO_MAX (RQ_NQS * RQ_PPQ - 1)
+
+/* A thread that becomes ready returns to the processor it last ran on, unless
+ * that one has more than AFFINITY_SLACK threads above the least loaded one. */
+#define AFFINITY_SLACK 2
+
+/* Idle processor steals a thread only if it waits on a run queue. */
+#define STEAL_THRESHOLD 1
+
+#define SCHED_LAT_BAND_PRIOS ((PRIO_MAX + 1) / SCHED_LAT_BANDS)
+
+/* All guarded by the big kernel lock. */
+static unsigned sched_nmigrations;
+static unsigned sched_nsteals;
+static sched_lat_band_t sched_lat[SCHED_LAT_BANDS];
 
 static void sched_init(void) {
-  runq_init(&runq);
+  for (unsigned i = 0; i < MAXCPU; i++)
+    runq_init(&_pcpu_data[i].runq);
+}
+
+void sched_stats(sched_stats_t *stats) {
+  stats->migrations = sched_nmigrations;
+  stats->steals = sched_nsteals;
+}
+
+void sched_lat_get(sched_lat_band_t bands[SCHED_LAT_BANDS]) {
+  memcpy(bands, sched_lat, sizeof(sched_lat));
+}
+
+void sched_lat_reset(void) {
+  bzero(sched_lat, sizeof(sched_lat));
+}
+
+/* Number of significant bits of @value, but at most @nbuckets - 1. */
+static unsigned sched_lat_bucket(unsigned value, unsigned nbuckets) {
+  unsigned i = value ? 32 - clz(value) : 0;
+  return min(i, nbuckets - 1);
+}
+
+/* Records how long a woken up thread waited to be dispatched at @now, and how
+ * many threads were on the run queue it was taken from. */
+static void sched_lat_record(thread_t *td, cputicks_t now, unsigned depth) {
+  unsigned us = cputicks2us(now - td->td_last_wkptime);
+
+  sched_lat_band_t *band = &sched_lat[td->td_prio / SCHED_LAT_BAND_PRIOS];
+  band->count++;
+  band->max_latency = max(band->max_latency, us);
+  band->latency[sched_lat_bucket(us, SCHED_LAT_BUCKETS)]++;
+  band->depth[sched_lat_bucket(depth, SCHED_DEPTH_BUCKETS)]++;
+}
+
+/* Accounts time interval to thread's history. Old history decays, so that
+ * the score follows changes in thread's behaviour. */
+static void sched_history_add(thread_t *td, cputicks_t run, cputicks_t slp) {
+  td->td_runhist += min(cputicks2us(run), (unsigned)INTERACT_HISTORY);
+  td->td_slphist += min(cputicks2us(slp), (unsigned)INTERACT_HISTORY);
+
+  while (td->td_runhist + td->td_slphist > INTERACT_HISTORY) {
+    td->td_runhist = td->td_runhist / 5 * 4;
+    td->td_slphist = td->td_slphist / 5 * 4;
+  }
+}
+
+static unsigned sched_interact_score(thread_t *td) {
+  unsigned run = td->td_runhist;
+  unsigned slp = td->td_slphist;
+
+  if (run == slp)
+    return INTERACT_HALF;
+  if (slp > run)
+    return INTERACT_HALF * run / slp;
+  return INTERACT_MAX - INTERACT_HALF * slp / run;
+}
+
+static int sched_slice(thread_t *td) {
+  if (td->td_policy == SCHED_RR)
+    return SLICE_RR;
+
+  unsigned score = sched_interact_score(td);
+  return SLICE_MIN + (SLICE_MAX - SLICE_MIN) * score / INTERACT_MAX;
+}
+
+/*! \brief Recomputes dynamic priority of a user thread.
+ *
+ * \note Thread must not be on a run queue! */
+static void sched_interact_update(thread_t *td) {
+  /* Kernel and real-time threads have fixed priorities, and lent priority
+   * must stay. */
+  if (td->td_proc == NULL || td->td_policy != SCHED_OTHER ||
+      td_is_borrowing(td))
+    return;
+
+  unsigned score = sched_interact_score(td);
+  unsigned prio =
+    td->td_base_prio + INTERACT_BAND * (INTERACT_MAX - score) / INTERACT_MAX;
+  td->td_prio = min(prio, (unsigned)PRIO_USER_MAX);
+}
+
+static runq_t *sched_runq(unsigned cpu) {
+  return &_pcpu_data[cpu].runq;
+}
+
+/* Number of threads that compete for given processor. */
+static unsigned sched_load(unsigned cpu) {
+  pcpu_t *pc = &_pcpu_data[cpu];
+  return pc->runq.rq_count + (pc->curthread != pc->idle_thread);
+}
+
+/*! \brief Chooses processor which run queue a ready thread goes to. */
+static unsigned sched_pick_cpu(thread_t *td) {
+  unsigned best = td->td_cpu;
+
+  for (unsigned i = 0; i < MAXCPU; i++)
+    if (_pcpu_data[i].running && sched_load(i) < sched_load(best))
+      best = i;
+
+  if (sched_load(td->td_cpu) > sched_load(best) + AFFINITY_SLACK)
+    return best;
+  return td->td_cpu;
 }
 
 void sched_add(thread_t *td) {
@@ -36,21 +173,37 @@ void sched_wakeup(thread_t *td, long reason) {
   assert(td_is_blocked(td) || td_is_sleeping(td) || td_is_inactive(td));
 
   /* Update sleep time. */
-  timeval_t now = get_uptime();
-  now = timeval_sub(&now, &td->td_last_slptime);
-  td->td_slptime = timeval_add(&td->td_slptime, &now);
+  cputicks_t now = getcputicks();
+  cputicks_t diff = now - td->td_last_slptime;
+  td->td_slptime += diff;
+  if (td_is_sleeping(td))
+    sched_history_add(td, 0, diff);
+
+  /* Start measuring wakeup-to-run latency. */
+  td->td_last_wkptime = now;
 
   td->td_state = TDS_READY;
-  td->td_slice = SLICE;
+  sched_interact_update(td);
+  td->td_slice = sched_slice(td);
 
   ctx_set_retval(&td->td_kctx, reason);
 
-  runq_add(&runq, td);
+  unsigned cpu = sched_pick_cpu(td);
+  if (cpu != td->td_cpu) {
+    td->td_cpu = cpu;
+    sched_nmigrations++;
+  }
+
+  runq_add(sched_runq(cpu), td);
 
-  /* Check if we need to reschedule threads. */
-  thread_t *oldtd = thread_self();
-  if (td->td_prio > oldtd->td_prio)
-    oldtd->td_flags |= TDF_NEEDSWITCH;
+  /* Check if we need to reschedule threads. Other processors notice that on
+   * their next clock tick. A thread running on another processor holds no
+   * spinlocks, since the processor is outside of the kernel. */
+  thread_t *oldtd = _pcpu_data[cpu].curthread;
+  WITH_SPINLOCK(oldtd->td_spin) {
+    if (td->td_prio > oldtd->td_prio)
+      oldtd->td_flags |= TDF_NEEDSWITCH;
+  }
 }
 
 /*! \brief Set thread's active priority \a td_prio to \a prio.
@@ -65,9 +218,10 @@ static void sched_set_active_prio(thread_t *td, prio_t prio) {
 
   if (td_is_ready(td)) {
     /* Thread is on a run queue. */
-    runq_remove(&runq, td);
+    runq_t *rq = sched_runq(td->td_cpu);
+    runq_remove(rq, td);
     td->td_prio = prio;
-    runq_add(&runq, td);
+    runq_add(rq, td);
   } else {
     td->td_prio = prio;
   }
@@ -109,17 +263,86 @@ void sched_unlend_prio(thread_t *td, prio_t prio) {
     sched_lend_prio(td, prio);
 }
 
+int sched_setscheduler(thread_t *td, int policy, int priority) {
+  prio_t prio;
+
+  if (policy == SCHED_OTHER && priority == 0)
+    prio = td->td_proc ? 0 : PRIO_KTHREAD;
+  else if ((policy == SCHED_FIFO || policy == SCHED_RR) && priority >= 0 &&
+           priority <= PRIO_RT_MAX - PRIO_RT_MIN)
+    prio = PRIO_RT_MIN + priority;
+  else
+    return -EINVAL;
+
+  WITH_SPINLOCK(td->td_spin) {
+    td->td_policy = policy;
+    td->td_slice = sched_slice(td);
+    sched_set_prio(td, prio);
+    /* Let the scheduler reconsider if the thread should be running. */
+    if (td_is_running(td))
+      td->td_flags |= TDF_NEEDSWITCH;
+  }
+
+  return 0;
+}
+
+int sched_getscheduler(thread_t *td) {
+  return td->td_policy;
+}
+
+/*! \brief Finds a thread to be taken over from the busiest processor. */
+static thread_t *sched_steal(void) {
+  unsigned self = PCPU_GET(cpuid);
+  unsigned victim = self;
+  unsigned count = STEAL_THRESHOLD - 1;
+
+  for (unsigned i = 0; i < MAXCPU; i++) {
+    if (i != self && _pcpu_data[i].runq.rq_count > count) {
+      victim = i;
+      count = _pcpu_data[i].runq.rq_count;
+    }
+  }
+
+  if (victim == self)
+    return NULL;
+
+  sched_nsteals++;
+  return runq_choose(sched_runq(victim));
+}
+
+/* Checks without taking any locks if there's a thread this processor could
+ * run. */
+static bool sched_has_work(void) {
+  if (!runq_empty(PCPU_PTR(runq)))
+    return true;
+
+  for (unsigned i = 0; i < MAXCPU; i++) {
+    volatile unsigned *count = &_pcpu_data[i].runq.rq_count;
+    if (*count >= STEAL_THRESHOLD)
+      return true;
+  }
+  return false;
+}
+
 /*! \brief Chooses next thread to run.
  *
  * \note Returned thread is marked as running!
  */
 static thread_t *sched_choose(void) {
-  thread_t *td = runq_choose(&runq);
-  if (td == NULL)
+  thread_t *td = runq_choose(PCPU_PTR(runq));
+  if (td == NULL && (td = sched_steal()) == NULL)
     return PCPU_GET(idle_thread);
-  runq_remove(&runq, td);
+  runq_t *rq = sched_runq(td->td_cpu);
+  unsigned depth = rq->rq_count;
+  runq_remove(rq, td);
+  td->td_cpu = PCPU_GET(cpuid);
   td->td_state = TDS_RUNNING;
-  td->td_last_rtime = get_uptime();
+  td->td_last_rtime = getcputicks();
+  /* Preempted threads return to run queue without being woken up. */
+  if (td->td_last_wkptime) {
+    sched_lat_record(td, td->td_last_rtime, depth);
+    td->td_last_wkptime = 0;
+  }
   return td;
 }
 
@@ -132,17 +355,29 @@ long sched_switch(void) {
   assert(spin_owned(td->td_spin));
   assert(!td_is_running(td));
 
+  /* Real-time thread preempted before its slice ended is not moved behind
+   * other threads of the same priority. */
+  bool preempted = (td->td_flags & (TDF_SLICEEND | TDF_NEEDSWITCH)) ==
+                   TDF_NEEDSWITCH;
   td->td_flags &= ~(TDF_SLICEEND | TDF_NEEDSWITCH);
 
   /* Update running time, */
-  timeval_t now = get_uptime();
-  timeval_t diff = timeval_sub(&now, &td->td_last_rtime);
-  td->td_rtime = timeval_add(&td->td_rtime, &diff);
+  cputicks_t now = getcputicks();
+  cputicks_t diff = now - td->td_last_rtime;
+  td->td_rtime += diff;
+  sched_history_add(td, diff, 0);
 
   if (td_is_ready(td)) {
     /* Idle threads need not to be inserted into the run queue. */
-    if (td != PCPU_GET(idle_thread))
-      runq_add(&runq, td);
+    if (td != PCPU_GET(idle_thread)) {
+      sched_interact_update(td);
+      if (td->td_slice <= 0)
+        td->td_slice = sched_slice(td);
+      if (preempted && td->td_policy != SCHED_OTHER)
+        runq_add_head(PCPU_PTR(runq), td);
+      else
+        runq_add(PCPU_PTR(runq), td);
+    }
   } else if (td_is_sleeping(td)) {
     /* Record when the thread fell asleep. */
     td->td_last_slptime = now;
@@ -169,7 +404,8 @@ void sched_clock(void) {
 
   thread_t *td = thread_self();
 
-  if (td != PCPU_GET(idle_thread)) {
+  /* SCHED_FIFO threads run until they give up the processor. */
+  if (td != PCPU_GET(idle_thread) && td->td_policy != SCHED_FIFO) {
     WITH_SPINLOCK(td->td_spin) {
       if (--td->td_slice <= 0)
         td->td_flags |= TDF_NEEDSWITCH | TDF_SLICEEND;
@@ -177,6 +413,29 @@ void sched_clock(void) {
   }
 }
 
+/*
+ * Halts the processor until some thread becomes ready to run. The big kernel
+ * lock is released meanwhile, so that other processors can enter the kernel.
+ *
+ * Only interrupt handlers can give work to the only processor, so the clock
+ * gets stopped till the nearest callout. Otherwise the processor must wake up
+ * on each tick, as it cannot be notified about work and IPIs in other way.
+ */
+static void sched_idle_wait(void) {
+  while (!sched_has_work()) {
+    intr_disable();
+    if (ncpus == 1)
+      clock_idle_enter();
+    bkl_release();
+    if (!sched_has_work())
+      intr_wait();
+    bkl_acquire();
+    clock_idle_leave();
+    /* Pending interrupts are handled here. */
+    intr_enable();
+  }
+}
+
 noreturn void sched_run(void) {
   thread_t *td = thread_self();
 
@@ -185,14 +444,20 @@ noreturn void sched_run(void) {
 
   PCPU_SET(idle_thread, td);
 
-  td->td_name = "idle-thread";
+  strlcpy(td->td_name, "idle-thread", TD_NAME_MAX);
   td->td_slice = 0;
+  td->td_prio = td->td_base_prio = 0;
 
   sched_active = true;
 
   while (true) {
+    /* Do background work unless there's a thread waiting to be run. */
+    while (!sched_has_work() && pmap_idle())
+      continue;
+    sched_idle_wait();
     WITH_SPINLOCK(td->td_spin) {
-      td->td_flags |= TDF_NEEDSWITCH;
+      td->td_state = TDS_READY;
+      sched_switch();
     }
   }
 }
@@ -30,7 +30,10 @@ int do_kill(pid_t pid, signo_t sig) {
   proc_t *target = proc_find(pid);
   if (target == NULL)
     return -EINVAL;
-  return sig_send(target, sig);
+  /* Keep the lock, so that target cannot exit before the signal is posted. */
+  int error = sig_send(target, sig);
+  mtx_unlock(&target->p_lock);
+  return error;
 }
 
 int do_sigaction(signo_t sig, const sigaction_t *act, sigaction_t *oldact) {
@@ -67,6 +70,7 @@ static int sig_default(signo_t sig) {
  * states) make the logic of sending a signal very simple!
  */
 int sig_send(proc_t *proc, signo_t sig) {
+  assert(mtx_owned(&proc->p_lock));
   assert(sig < NSIG);
 
   thread_t *target = proc->p_thread;
@@ -77,13 +81,11 @@ int sig_send(proc_t *proc, signo_t sig) {
   if (td_is_dead(target))
     return -EINVAL;
 
-  WITH_MTX_LOCK (&target->td_proc->p_lock) {
-    /* If the signal is ignored, don't even bother posting it. */
-    sighandler_t *handler = target->td_proc->p_sigactions[sig].sa_handler;
-    if (handler == SIG_IGN ||
-        (sig_default(sig) == SA_IGNORE && handler == SIG_DFL))
-      return 0;
-  }
+  /* If the signal is ignored, don't even bother posting it. */
+  sighandler_t *handler = proc->p_sigactions[sig].sa_handler;
+  if (handler == SIG_IGN ||
+      (sig_default(sig) == SA_IGNORE && handler == SIG_DFL))
+    return 0;
 
   bit_set(target->td_sigpend, sig);
 
@@ -106,7 +108,9 @@ void sig_notify(thread_t *td) {
 }
 
 int sig_check(thread_t *td) {
-  assert(td->td_proc);
+  proc_t *p = td->td_proc;
+  assert(p);
+  assert(mtx_owned(&p->p_lock));
 
   signo_t sig = NSIG;
   while (true) {
@@ -116,8 +120,7 @@ int sig_check(thread_t *td) {
 
     bit_clear(td->td_sigpend, sig);
 
-    SCOPED_MTX_LOCK(&td->td_proc->p_lock);
-    sighandler_t *handler = td->td_proc->p_sigactions[sig].sa_handler;
+    sighandler_t *handler = p->p_sigactions[sig].sa_handler;
 
     if (handler == SIG_IGN ||
         (handler == SIG_DFL && sig_default(sig) == SA_IGNORE))
@@ -135,15 +138,16 @@ int sig_check(thread_t *td) {
   }
 
 term:
-  /* Release the lock held by the parent. */
+  /* Release the locks held by the caller. */
   mtx_unlock(&td->td_lock);
+  mtx_unlock(&p->p_lock);
   proc_exit(MAKE_STATUS_SIG_TERM(sig));
 }
 
 void sig_deliver(signo_t sig) {
   thread_t *td = thread_self();
   assert(td->td_proc);
-  SCOPED_MTX_LOCK(&td->td_proc->p_lock);
+  assert(mtx_owned(&td->td_proc->p_lock));
   sigaction_t *sa = td->td_proc->p_sigactions + sig;
 
   assert(sa->sa_handler != SIG_IGN && sa->sa_handler != SIG_DFL);
@@ -0,0 +1,68 @@
+#include <stdc.h>
+#include <atomic.h>
+#include <pcpu.h>
+#include <pmap.h>
+#include <smp.h>
+
+unsigned ncpus = 1;
+
+/* Number of the processor that holds the lock plus one, or zero. */
+static volatile uint32_t bkl_owner;
+
+bool bkl_owned(void) {
+  return bkl_owner == PCPU_GET(cpuid) + 1;
+}
+
+void bkl_acquire(void) {
+  assert(!bkl_owned());
+
+  /* Lock holder may be waiting for this processor to handle an IPI. */
+  while (!atomic_cmp_exchange(&bkl_owner, 0, PCPU_GET(cpuid) + 1))
+    ipi_poll();
+
+  /* Handle IPIs that were posted while this processor was outside of the
+   * kernel and nobody waited for. */
+  ipi_poll();
+}
+
+void bkl_release(void) {
+  assert(bkl_owned());
+
+  atomic_store(&bkl_owner, 0);
+}
+
+void ipi_post(pcpu_t *pc, unsigned ipi) {
+  assert(bkl_owned());
+  assert(pc != _pcpu());
+
+  unsigned pending;
+  do {
+    pending = pc->ipi;
+  } while (!atomic_cmp_exchange(&pc->ipi, pending, pending | ipi));
+}
+
+void ipi_wait(pcpu_t *pc, unsigned ipi) {
+  assert(bkl_owned());
+
+  /* Target clears the bits once it's done with handling them. */
+  while (pc->ipi & ipi)
+    continue;
+}
+
+void ipi_poll(void) {
+  volatile unsigned *ipi = PCPU_PTR(ipi);
+  unsigned pending = *ipi;
+
+  if (pending == 0)
+    return;
+
+  if (pending & IPI_TLB_FLUSH)
+    pmap_tlb_flush_ipi();
+  else if (pending & IPI_TLB_SHOOTDOWN)
+    pmap_tlb_shootdown_ipi();
+
+  unsigned current;
+  do {
+    current = *ipi;
+  } while (!atomic_cmp_exchange(ipi, current, current & ~pending));
+}
@@ -2,6 +2,7 @@
 #include <klog.h>
 #include <stdc.h>
 #include <sched.h>
+#include <smp.h>
 #include <thread.h>
 #include <sysinit.h>
 #include <vfs.h>
@@ -26,6 +27,8 @@ int kernel_init(int argc, char **argv) {
   sysinit();
   klog("Kernel initialized!");
 
+  smp_start();
+
   thread_t *main_thread = thread_create("main", main, NULL);
   sched_add(main_thread);
 
@@ -0,0 +1,351 @@
+#define KL_LOG KL_VM
+#include <klog.h>
+#include <stdc.h>
+#include <bitstring.h>
+#include <mutex.h>
+#include <pool.h>
+#include <physmem.h>
+#include <vm_object.h>
+#include <swap.h>
+
+/* Swap map of an object is a list of blocks. Each block describes slots of
+ * SWBLK_PAGES consecutive pages, aligned to that number. */
+#define SWBLK_PAGES 16
+
+typedef struct swblk {
+  TAILQ_ENTRY(swblk) link;
+  vm_pindex_t index; /* index of the first page described by the block */
+  unsigned count;    /* number of used entries in slots array */
+  swslot_t slots[SWBLK_PAGES];
+} swblk_t;
+
+static POOL_DEFINE(P_SWBLK, "swblk", sizeof(swblk_t));
+
+/* Number of blocks kept aside, so that pageout can make progress when the
+ * pool cannot grow because physical memory is exhausted. */
+#define SWBLK_RESERVE (PAGESIZE / sizeof(swblk_t))
+
+/* Guards backing store, slot bitmap and swap maps of all objects. */
+static mtx_t swap_lock = MTX_INITIALIZER(MTX_DEF);
+static swap_dev_t *swap_dev;
+static bitstr_t *swap_bitmap;
+static size_t swap_nfree;
+static swblk_t *swblk_reserve;
+static struct swblk_list swblk_reserve_free =
+  TAILQ_HEAD_INITIALIZER(swblk_reserve_free);
+
+/* Used to copy slot contents without allocating pages. */
+static uint8_t swap_bounce[PAGESIZE];
+
+void swap_attach(swap_dev_t *sd) {
+  assert(swap_dev == NULL);
+  assert(sd->sd_nslots > 0);
+
+  /* Bitmap is carved out of physical memory, as it may be quite big. */
+  size_t size = bitstr_size(sd->sd_nslots);
+  size_t npages = 1;
+  while (npages * PAGESIZE < size)
+    npages *= 2;
+
+  vm_page_t *pg = pm_alloc(npages);
+  if (pg == NULL)
+    panic("cannot allocate bitmap for %ld swap slots", sd->sd_nslots);
+
+  swap_bitmap = PG_KSEG0_ADDR(pg);
+  bzero(swap_bitmap, size);
+
+  if ((pg = pm_alloc(1)) == NULL)
+    panic("cannot allocate reserve of swap map blocks");
+
+  swblk_reserve = PG_KSEG0_ADDR(pg);
+  for (unsigned i = 0; i < SWBLK_RESERVE; i++)
+    TAILQ_INSERT_TAIL(&swblk_reserve_free, &swblk_reserve[i], link);
+
+  swap_nfree = sd->sd_nslots;
+  swap_dev = sd;
+
+  klog("Swap device '%s' with %ld slots attached", sd->sd_name, sd->sd_nslots);
+}
+
+static void swap_ram_read(swap_dev_t *sd, swslot_t slot, void *buf) {
+  memcpy(buf, sd->sd_data + slot * PAGESIZE, PAGESIZE);
+}
+
+static void swap_ram_write(swap_dev_t *sd, swslot_t slot, const void *buf) {
+  memcpy(sd->sd_data + slot * PAGESIZE, buf, PAGESIZE);
+}
+
+static swap_dev_t swap_ram_dev = {
+  .sd_name = "ram", .sd_read = swap_ram_read, .sd_write = swap_ram_write,
+};
+
+void swap_ram_attach(paddr_t start, size_t size) {
+  assert(is_aligned(start, PAGESIZE));
+
+  swap_ram_dev.sd_nslots = size / PAGESIZE;
+  swap_ram_dev.sd_data = (void *)MIPS_PHYS_TO_KSEG0(start);
+  swap_attach(&swap_ram_dev);
+}
+
+size_t swap_available(void) {
+  SCOPED_MTX_LOCK(&swap_lock);
+  return swap_nfree;
+}
+
+static swslot_t swap_slot_alloc(void) {
+  assert(mtx_owned(&swap_lock));
+
+  if (swap_nfree == 0)
+    return SWAP_NOSLOT;
+
+  int slot;
+  bit_ffc(swap_bitmap, swap_dev->sd_nslots, &slot);
+  assert(slot >= 0);
+  bit_set(swap_bitmap, slot);
+  swap_nfree--;
+  return slot;
+}
+
+static void swap_slot_free(swslot_t slot) {
+  assert(mtx_owned(&swap_lock));
+  assert(bit_test(swap_bitmap, slot));
+
+  bit_clear(swap_bitmap, slot);
+  swap_nfree++;
+}
+
+static swblk_t *swblk_find(vm_object_t *obj, vm_pindex_t idx) {
+  vm_pindex_t index = rounddown(idx, SWBLK_PAGES);
+  swblk_t *blk;
+  TAILQ_FOREACH (blk, &obj->swap, link)
+    if (blk->index == index)
+      return blk;
+  return NULL;
+}
+
+/* Blocks come from the pool unless it is unable to grow. */
+static swblk_t *swblk_alloc(void) {
+  swblk_t *blk = pool_alloc(P_SWBLK, PF_NOWAIT);
+  if (blk == NULL && (blk = TAILQ_FIRST(&swblk_reserve_free)))
+    TAILQ_REMOVE(&swblk_reserve_free, blk, link);
+  return blk;
+}
+
+static void swblk_free(swblk_t *blk) {
+  if (blk >= swblk_reserve && blk < swblk_reserve + SWBLK_RESERVE)
+    TAILQ_INSERT_HEAD(&swblk_reserve_free, blk, link);
+  else
+    pool_free(P_SWBLK, blk);
+}
+
+/* Returns false if there is no memory for a new block. */
+static bool swap_map_set(vm_object_t *obj, vm_pindex_t idx, swslot_t slot) {
+  swblk_t *blk = swblk_find(obj, idx);
+
+  if (blk == NULL) {
+    if ((blk = swblk_alloc()) == NULL)
+      return false;
+    blk->index = rounddown(idx, SWBLK_PAGES);
+    blk->count = 0;
+    for (int i = 0; i < SWBLK_PAGES; i++)
+      blk->slots[i] = SWAP_NOSLOT;
+    TAILQ_INSERT_TAIL(&obj->swap, blk, link);
+  }
+
+  assert(blk->slots[idx - blk->index] == SWAP_NOSLOT);
+  blk->slots[idx - blk->index] = slot;
+  blk->count++;
+  return true;
+}
+
+/* Removes an entry from the block and releases the block if it became empty.
+ * Returns the slot the entry held. */
+static swslot_t swblk_take(vm_object_t *obj, swblk_t *blk, unsigned i) {
+  swslot_t slot = blk->slots[i];
+  if (slot == SWAP_NOSLOT)
+    return SWAP_NOSLOT;
+
+  blk->slots[i] = SWAP_NOSLOT;
+  if (--blk->count == 0) {
+    TAILQ_REMOVE(&obj->swap, blk, link);
+    swblk_free(blk);
+  }
+  return slot;
+}
+
+static swslot_t swap_map_take(vm_object_t *obj, vm_pindex_t idx) {
+  swblk_t *blk = swblk_find(obj, idx);
+  if (blk == NULL)
+    return SWAP_NOSLOT;
+  return swblk_take(obj, blk, idx - blk->index);
+}
+
+bool swap_pageout(vm_object_t *obj, vm_page_t *pg) {
+  assert(pg->object == obj && pg->size == 1);
+
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  if (swap_dev == NULL)
+    return false;
+
+  swslot_t slot = swap_slot_alloc();
+  if (slot == SWAP_NOSLOT)
+    return false;
+
+  if (!swap_map_set(obj, OFF_TO_IDX(pg->offset), slot)) {
+    swap_slot_free(slot);
+    return false;
+  }
+
+  swap_dev->sd_write(swap_dev, slot, PG_KSEG0_ADDR(pg));
+  vm_object_remove_page(obj, pg);
+  return true;
+}
+
+bool swap_pagein(vm_object_t *obj, off_t offset, vm_page_t *pg) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  swslot_t slot = swap_map_take(obj, OFF_TO_IDX(offset));
+  if (slot == SWAP_NOSLOT)
+    return false;
+
+  swap_dev->sd_read(swap_dev, slot, PG_KSEG0_ADDR(pg));
+  swap_slot_free(slot);
+  return true;
+}
+
+bool swap_has_page(vm_object_t *obj, off_t offset) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  vm_pindex_t idx = OFF_TO_IDX(offset);
+  swblk_t *blk = swblk_find(obj, idx);
+  return blk && blk->slots[idx - blk->index] != SWAP_NOSLOT;
+}
+
+bool swap_range_empty(vm_object_t *obj, off_t start, off_t end) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  vm_pindex_t first = OFF_TO_IDX(start);
+  vm_pindex_t last = OFF_TO_IDX(end);
+
+  swblk_t *blk;
+  TAILQ_FOREACH (blk, &obj->swap, link) {
+    if (blk->index >= last || blk->index + SWBLK_PAGES <= first)
+      continue;
+    for (unsigned i = 0; i < SWBLK_PAGES; i++) {
+      vm_pindex_t idx = blk->index + i;
+      if (idx >= first && idx < last && blk->slots[i] != SWAP_NOSLOT)
+        return false;
+    }
+  }
+  return true;
+}
+
+void swap_free_range(vm_object_t *obj, off_t start, off_t end) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  vm_pindex_t first = OFF_TO_IDX(start);
+  vm_pindex_t last = OFF_TO_IDX(end);
+
+  swblk_t *blk, *next;
+  TAILQ_FOREACH_SAFE (blk, &obj->swap, link, next) {
+    if (blk->index >= last || blk->index + SWBLK_PAGES <= first)
+      continue;
+    /* Block may be released while taking its last entry. */
+    vm_pindex_t index = blk->index;
+    unsigned count = blk->count;
+    for (unsigned i = 0; i < SWBLK_PAGES && count > 0; i++) {
+      if (index + i < first || index + i >= last)
+        continue;
+      swslot_t slot = swblk_take(obj, blk, i);
+      if (slot != SWAP_NOSLOT) {
+        swap_slot_free(slot);
+        count--;
+      }
+    }
+  }
+}
+
+void swap_free_object(vm_object_t *obj) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  swblk_t *blk;
+  while ((blk = TAILQ_FIRST(&obj->swap))) {
+    for (unsigned i = 0; i < SWBLK_PAGES; i++)
+      if (blk->slots[i] != SWAP_NOSLOT)
+        swap_slot_free(blk->slots[i]);
+    TAILQ_REMOVE(&obj->swap, blk, link);
+    swblk_free(blk);
+  }
+}
+
+/* Moves all blocks of @obj swap map onto @list. */
+static void swap_map_detach(vm_object_t *obj, struct swblk_list *list) {
+  swblk_t *blk;
+  while ((blk = TAILQ_FIRST(&obj->swap))) {
+    TAILQ_REMOVE(&obj->swap, blk, link);
+    TAILQ_INSERT_TAIL(list, blk, link);
+  }
+}
+
+/* Releases blocks on @list putting their entries back into swap maps. Entries
+ * with page index below @first return to @obj unchanged, others are moved to
+ * @dst with page index increased by @delta (modulo index range). */
+static void swap_map_attach(struct swblk_list *list, vm_object_t *obj,
+                            vm_object_t *dst, vm_pindex_t first,
+                            vm_pindex_t delta) {
+  swblk_t *blk;
+  while ((blk = TAILQ_FIRST(list))) {
+    TAILQ_REMOVE(list, blk, link);
+    for (unsigned i = 0; i < SWBLK_PAGES; i++) {
+      swslot_t slot = blk->slots[i];
+      vm_pindex_t idx = blk->index + i;
+      if (slot == SWAP_NOSLOT)
+        continue;
+      bool ok = (idx < first) ? swap_map_set(obj, idx, slot)
+                              : swap_map_set(dst, idx + delta, slot);
+      if (!ok)
+        panic("out of memory for swap map");
+    }
+    swblk_free(blk);
+  }
+}
+
+void swap_split(vm_object_t *obj, vm_object_t *new_obj, off_t offset) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  struct swblk_list list = TAILQ_HEAD_INITIALIZER(list);
+  vm_pindex_t first = OFF_TO_IDX(offset);
+  swap_map_detach(obj, &list);
+  swap_map_attach(&list, obj, new_obj, first, -first);
+}
+
+void swap_clone(vm_object_t *obj, vm_object_t *new_obj) {
+  SCOPED_MTX_LOCK(&swap_lock);
+
+  swblk_t *blk;
+  TAILQ_FOREACH (blk, &obj->swap, link) {
+    for (unsigned i = 0; i < SWBLK_PAGES; i++) {
+      if (blk->slots[i] == SWAP_NOSLOT)
+        continue;
+
+      vm_pindex_t idx = blk->index + i;
+      swslot_t slot = swap_slot_alloc();
+
+      if (slot != SWAP_NOSLOT) {
+        swap_dev->sd_read(swap_dev, blk->slots[i], swap_bounce);
+        swap_dev->sd_write(swap_dev, slot, swap_bounce);
+        if (!swap_map_set(new_obj, idx, slot))
+          panic("out of memory for swap map");
+        continue;
+      }
+
+      /* Backing store is full, so the copy has to stay in memory. */
+      vm_page_t *pg = pm_alloc(1);
+      if (pg == NULL)
+        panic("out of memory and swap space");
+      swap_dev->sd_read(swap_dev, blk->slots[i], PG_KSEG0_ADDR(pg));
+      vm_object_add_page(new_obj, IDX_TO_OFF(idx), pg);
+    }
+  }
+}
@@ -15,6 +15,8 @@
 #include <systm.h>
 #include <wait.h>
 #include <syslimits.h>
+#include <resource.h>
+#include <sched.h>
 
 /* Empty syscall handler, for unimplemented and deprecated syscall numbers. */
 int sys_nosys(thread_t *td, syscall_args_t *args) {
@@ -99,6 +101,115 @@ static int sys_mmap(thread_t *td, syscall_args_t *args) {
   return addr;
 }
 
+static int sys_munmap(thread_t *td, syscall_args_t *args) {
+  vaddr_t addr = args->args[0];
+  size_t length = args->args[1];
+
+  klog("munmap(%p, %u)", (void *)addr, length);
+
+  return do_munmap(addr, length);
+}
+
+static int sys_mprotect(thread_t *td, syscall_args_t *args) {
+  vaddr_t addr = args->args[0];
+  size_t length = args->args[1];
+  vm_prot_t prot = args->args[2];
+
+  klog("mprotect(%p, %u, %d)", (void *)addr, length, prot);
+
+  return do_mprotect(addr, length, prot);
+}
+
+static int sys_madvise(thread_t *td, syscall_args_t *args) {
+  vaddr_t addr = args->args[0];
+  size_t length = args->args[1];
+  int advice = args->args[2];
+
+  klog("madvise(%p, %u, %d)", (void *)addr, length, advice);
+
+  return do_madvise(addr, length, advice);
+}
+
+static int sys_mincore(thread_t *td, syscall_args_t *args) {
+  vaddr_t addr = args->args[0];
+  size_t length = args->args[1];
+  char *vec = (char *)args->args[2];
+
+  klog("mincore(%p, %u, %p)", (void *)addr, length, vec);
+
+  return do_mincore(addr, length, vec);
+}
+
+static int sys_getrusage(thread_t *td, syscall_args_t *args) {
+  int who = args->args[0];
+  struct rusage *usage_p = (struct rusage *)args->args[1];
+
+  klog("getrusage(%d, %p)", who, usage_p);
+
+  struct rusage usage;
+  int error = proc_getrusage(td->td_proc, who, &usage);
+  if (error)
+    return error;
+  return copyout_s(usage, usage_p);
+}
+
+static int sys_getrlimit(thread_t *td, syscall_args_t *args) {
+  int resource = args->args[0];
+  struct rlimit *rlp = (struct rlimit *)args->args[1];
+
+  klog("getrlimit(%d, %p)", resource, rlp);
+
+  struct rlimit rlim;
+  int error = proc_getrlimit(td->td_proc, resource, &rlim);
+  if (error)
+    return error;
+  return copyout_s(rlim, rlp);
+}
+
+static int sys_setrlimit(thread_t *td, syscall_args_t *args) {
+  int resource = args->args[0];
+  const struct rlimit *rlp = (const struct rlimit *)args->args[1];
+
+  klog("setrlimit(%d, %p)", resource, rlp);
+
+  struct rlimit rlim;
+  int error = copyin_s(rlp, rlim);
+  if (error)
+    return error;
+  return proc_setrlimit(td->td_proc, resource, &rlim);
+}
+
+/* Only the calling process may have its scheduling policy changed for now. */
+static int sys_sched_setscheduler(thread_t *td, syscall_args_t *args) {
+  pid_t pid = args->args[0];
+  int policy = args->args[1];
+  const struct sched_param *param_p = (const struct sched_param *)args->args[2];
+
+  klog("sched_setscheduler(%d, %d, %p)", pid, policy, param_p);
+
+  if (pid != 0 && pid != td->td_proc->p_pid)
+    return -EPERM;
+
+  struct sched_param param;
+  int error = copyin_s(param_p, param);
+  if (error)
+    return error;
+  /* Do not let user threads preempt real-time kernel threads. */
+  if (param.sched_priority > PRIO_RT_USER_MAX - PRIO_RT_MIN)
+    return -EINVAL;
+  return sched_setscheduler(td, policy, param.sched_priority);
+}
+
+static int sys_sched_getscheduler(thread_t *td, syscall_args_t *args) {
+  pid_t pid = args->args[0];
+
+  klog("sched_getscheduler(%d)", pid);
+
+  if (pid != 0 && pid != td->td_proc->p_pid)
+    return -EPERM;
+  return sched_getscheduler(td);
+}
+
 static int sys_open(thread_t *td, syscall_args_t *args) {
   char *user_pathname = (char *)args->args[0];
   int flags = args->args[1];
@@ -404,4 +515,13 @@ sysent_t sysent[] = {
     [SYS_MKDIR] = {sys_mkdir},
     [SYS_RMDIR] = {sys_rmdir},
     [SYS_ACCESS] = {sys_access},
+    [SYS_MUNMAP] = {sys_munmap},
+    [SYS_MPROTECT] = {sys_mprotect},
+    [SYS_MADVISE] = {sys_madvise},
+    [SYS_MINCORE] = {sys_mincore},
+    [SYS_GETRUSAGE] = {sys_getrusage},
+    [SYS_GETRLIMIT] = {sys_getrlimit},
+    [SYS_SETRLIMIT] = {sys_setrlimit},
+    [SYS_SCHED_SETSCHEDULER] = {sys_sched_setscheduler},
+    [SYS_SCHED_GETSCHEDULER] = {sys_sched_getscheduler},
 };
@@ -1,5 +1,6 @@
 #define KL_LOG KL_THREAD
 #include <klog.h>
+#include <stdc.h>
 #include <malloc.h>
 #include <physmem.h>
 #include <thread.h>
@@ -16,9 +17,22 @@ static MALLOC_DEFINE(M_THREAD, "thread", 1, 2);
 
 typedef TAILQ_HEAD(, thread) thread_list_t;
 
+/* Reaped threads are kept fully constructed, i.e. with kernel stack, sleep
+ * queue and turnstile attached, so that creating a thread is cheap. */
+#define THREAD_CACHE_MAX 32
+
 static mtx_t *threads_lock = &MTX_INITIALIZER(MTX_DEF);
 static thread_list_t all_threads = TAILQ_HEAD_INITIALIZER(all_threads);
 static thread_list_t zombie_threads = TAILQ_HEAD_INITIALIZER(zombie_threads);
+static thread_list_t thread_cache = TAILQ_HEAD_INITIALIZER(thread_cache);
+static unsigned thread_cache_count;
+
+#define TIDHASH_SIZE 256 /* must be power of two */
+#define TIDHASH(tid) (&tidhash[(tid) & (TIDHASH_SIZE - 1)])
+
+/* Threads are in the hash table from creation until they're reaped. */
+static mtx_t *tidhash_lock = &MTX_INITIALIZER(MTX_DEF);
+static LIST_HEAD(, thread) tidhash[TIDHASH_SIZE];
 
 /* FTTB such a primitive method of creating new TIDs will do. */
 static tid_t make_tid(void) {
@@ -64,20 +78,48 @@ void thread_entry_setup(thread_t *td, entry_fn_t target, void *arg) {
   exc_frame_setup_call(kframe, thread_exit, (long)arg, 0);
 }
 
+/* Takes a thread from the cache or constructs a new one. Returned thread has
+ * all fields cleared except the ones that hold attached resources. */
+static thread_t *thread_alloc(void) {
+  thread_t *td;
+
+  WITH_MTX_LOCK (threads_lock) {
+    if ((td = TAILQ_FIRST(&thread_cache))) {
+      TAILQ_REMOVE(&thread_cache, td, td_all);
+      thread_cache_count--;
+    }
+  }
+
+  if (td == NULL) {
+    td = kmalloc(M_THREAD, sizeof(thread_t), 0);
+    td->td_sleepqueue = sleepq_alloc();
+    td->td_turnstile = turnstile_alloc();
+    td->td_kstack_obj = pm_alloc(1);
+  }
+
+  sleepq_t *sq = td->td_sleepqueue;
+  turnstile_t *ts = td->td_turnstile;
+  vm_page_t *kstack = td->td_kstack_obj;
+  bzero(td, sizeof(thread_t));
+  td->td_sleepqueue = sq;
+  td->td_turnstile = ts;
+  td->td_kstack_obj = kstack;
+  return td;
+}
+
 thread_t *thread_create(const char *name, void (*fn)(void *), void *arg) {
   /* Firstly recycle some threads to free up memory. */
   thread_reap();
 
-  thread_t *td = kmalloc(M_THREAD, sizeof(thread_t), M_ZERO);
+  thread_t *td = thread_alloc();
 
-  td->td_sleepqueue = sleepq_alloc();
-  td->td_turnstile = turnstile_alloc();
-  td->td_name = kstrndup(M_THREAD, name, TD_NAME_MAX);
+  strlcpy(td->td_name, name, TD_NAME_MAX);
   td->td_tid = make_tid();
-  td->td_kstack_obj = pm_alloc(1);
   td->td_kstack.stk_base = PG_KSEG0_ADDR(td->td_kstack_obj);
   td->td_kstack.stk_size = PAGESIZE;
   td->td_state = TDS_INACTIVE;
+  td->td_prio = td->td_base_prio = PRIO_KTHREAD;
+  td->td_cpu = PCPU_GET(cpuid); /* start next to the creator */
 
   spin_init(td->td_spin);
   mtx_init(&td->td_lock, MTX_RECURSE);
@@ -90,6 +132,9 @@ thread_t *thread_create(const char *name, void (*fn)(void *), void *arg) {
   WITH_MTX_LOCK (threads_lock)
     TAILQ_INSERT_TAIL(&all_threads, td, td_all);
 
+  WITH_MTX_LOCK (tidhash_lock)
+    LIST_INSERT_HEAD(TIDHASH(td->td_tid), td, td_hash);
+
   klog("Thread %ld {%p} has been created", td->td_tid, td);
 
   return td;
@@ -102,14 +147,27 @@ void thread_delete(thread_t *td) {
 
   klog("Freeing up thread %ld {%p}", td->td_tid, td);
 
-  WITH_MTX_LOCK (threads_lock)
+  WITH_MTX_LOCK (tidhash_lock)
+    LIST_REMOVE(td, td_hash);
+
+  bool cached = false;
+
+  WITH_MTX_LOCK (threads_lock) {
     TAILQ_REMOVE(&all_threads, td, td_all);
+    if (thread_cache_count < THREAD_CACHE_MAX) {
+      TAILQ_INSERT_HEAD(&thread_cache, td, td_all);
+      thread_cache_count++;
+      cached = true;
+    }
+  }
+
+  if (cached)
+    return;
 
   pm_free(td->td_kstack_obj);
 
   sleepq_destroy(td->td_sleepqueue);
   turnstile_destroy(td->td_turnstile);
-  kfree(M_THREAD, td->td_name);
   kfree(M_THREAD, td);
 }
 
@@ -174,17 +232,15 @@ void thread_yield(void) {
   }
 }
 
-/* It would be better to have a hash-map from tid_t to thread_t,
- * but using a list is sufficient for now. */
 thread_t *thread_find(tid_t id) {
-  SCOPED_MTX_LOCK(threads_lock);
+  SCOPED_MTX_LOCK(tidhash_lock);
 
   thread_t *td;
-  TAILQ_FOREACH (td, &all_threads, td_all) {
-    mtx_lock(&td->td_lock);
-    if (td->td_tid == id)
+  LIST_FOREACH (td, TIDHASH(id), td_hash) {
+    if (td->td_tid == id) {
+      mtx_lock(&td->td_lock);
       return td;
-    mtx_unlock(&td->td_lock);
+    }
   }
   return NULL;
 }
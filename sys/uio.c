@@ -2,6 +2,38 @@
 #include <systm.h>
 #include <stdc.h>
 #include <vm_map.h>
+#include <pmap.h>
+
+/* Moves data between kernel buffer and address space that is not active, by
+ * temporarily mapping each page of the foreign range into the kernel. */
+static int copy_foreign_vmspace(vm_map_t *vm, vaddr_t uaddr, char *kaddr,
+                                size_t len, uio_op_t op) {
+  vm_prot_t access = (op == UIO_READ) ? VM_PROT_WRITE : VM_PROT_READ;
+
+  while (len > 0) {
+    size_t offset = uaddr & (PAGESIZE - 1);
+    size_t n = min(len, PAGESIZE - offset);
+
+    vm_page_t *pg;
+    int error = vm_map_lookup_page(vm, uaddr, access, &pg);
+    if (error)
+      return error;
+
+    char *va = pmap_kmap(pg);
+    if (op == UIO_READ)
+      memcpy(va + offset, kaddr, n);
+    else
+      memcpy(kaddr, va + offset, n);
+    pmap_kunmap(va);
+    vm_map_release_page(vm, pg);
+
+    uaddr += n;
+    kaddr += n;
+    len -= n;
+  }
+
+  return 0;
+}
 
 static int copyin_vmspace(vm_map_t *vm, const void *restrict udaddr,
                           void *restrict kaddr, size_t len) {
@@ -14,7 +46,7 @@ static int copyin_vmspace(vm_map_t *vm, const void *restrict udaddr,
     return copyin(udaddr, kaddr, len);
   }
 
-  panic("copyin on non-active vm maps is not supported");
+  return copy_foreign_vmspace(vm, (vaddr_t)udaddr, kaddr, len, UIO_WRITE);
 }
 
 static int copyout_vmspace(vm_map_t *vm, const void *restrict kaddr,
@@ -28,7 +60,8 @@ static int copyout_vmspace(vm_map_t *vm, const void *restrict kaddr,
     return copyout(kaddr, udaddr, len);
   }
 
-  panic("copyout on non-active vm maps is not supported");
+  return copy_foreign_vmspace(vm, (vaddr_t)udaddr, (char *)kaddr, len,
+                              UIO_READ);
 }
 
 /* Heavily inspired by NetBSD's uiomove */
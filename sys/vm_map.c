@@ -1,8 +1,12 @@
 #define KL_LOG KL_VM
 #include <klog.h>
 #include <stdc.h>
+#include <mman.h>
+#include <resource.h>
 #include <pool.h>
 #include <pmap.h>
+#include <physmem.h>
+#include <swap.h>
 #include <vm_pager.h>
 #include <vm_object.h>
 #include <vm_map.h>
@@ -16,11 +20,15 @@ struct vm_segment {
   TAILQ_ENTRY(vm_segment) link;
   vm_object_t *object;
   vm_prot_t prot;
+  vm_flags_t flags; /* only VM_STACK is remembered */
+  int advice;       /* one of MADV_NORMAL or MADV_SEQUENTIAL */
   vaddr_t start;
   vaddr_t end;
+  vaddr_t origin; /* address that offset 0 of the object is mapped at */
 };
 
 struct vm_map {
+  TAILQ_ENTRY(vm_map) all; /* entry on list of user maps */
   TAILQ_HEAD(vm_map_list, vm_segment) entries;
   size_t nentries;
   pmap_t *pmap;
@@ -32,6 +40,10 @@ static POOL_DEFINE(P_VMENTRY, "vm_segment", sizeof(vm_segment_t));
 
 static vm_map_t *kspace = &(vm_map_t){};
 
+/* All user maps, in order they are visited by pageout. */
+static TAILQ_HEAD(vm_map_head, vm_map) vm_maps = TAILQ_HEAD_INITIALIZER(vm_maps);
+static mtx_t vm_maps_lock = MTX_INITIALIZER(MTX_DEF);
+
 void vm_map_activate(vm_map_t *map) {
   SCOPED_NO_PREEMPTION();
 
@@ -83,6 +95,8 @@ vm_map_t *vm_map_new(void) {
   vm_map_t *map = pool_alloc(P_VMMAP, PF_ZERO);
   vm_map_setup(map);
   map->pmap = pmap_new();
+  WITH_MTX_LOCK (&vm_maps_lock)
+    TAILQ_INSERT_TAIL(&vm_maps, map, all);
   return map;
 }
 
@@ -95,18 +109,24 @@ vm_segment_t *vm_segment_alloc(vm_object_t *obj, vaddr_t start, vaddr_t end,
   seg->object = obj;
   seg->start = start;
   seg->end = end;
+  seg->origin = start;
   seg->prot = prot;
   return seg;
 }
 
+/* Returns offset within the segment's object of page mapped at @va. */
+static inline off_t vm_segment_offset(vm_segment_t *seg, vaddr_t va) {
+  return va - seg->origin;
+}
+
 void vm_segment_free(vm_segment_t *seg) {
   if (seg->object)
     vm_object_free(seg->object);
   pool_free(P_VMENTRY, seg);
 }
 
-vm_segment_t *vm_map_find_segment(vm_map_t *map, vaddr_t vaddr) {
-  SCOPED_MTX_LOCK(&map->mtx);
+static vm_segment_t *vm_map_lookup_segment(vm_map_t *map, vaddr_t vaddr) {
+  assert(mtx_owned(&map->mtx));
   vm_segment_t *it;
   TAILQ_FOREACH (it, &map->entries, link)
     if (it->start <= vaddr && vaddr < it->end)
@@ -114,6 +134,11 @@ vm_segment_t *vm_map_find_segment(vm_map_t *map, vaddr_t vaddr) {
   return NULL;
 }
 
+vm_segment_t *vm_map_find_segment(vm_map_t *map, vaddr_t vaddr) {
+  SCOPED_MTX_LOCK(&map->mtx);
+  return vm_map_lookup_segment(map, vaddr);
+}
+
 static void vm_map_insert_after(vm_map_t *map, vm_segment_t *after,
                                 vm_segment_t *seg) {
   assert(mtx_owned(&map->mtx));
@@ -131,19 +156,107 @@ static void vm_map_remove_segment(vm_map_t *map, vm_segment_t *seg) {
 }
 
 void vm_map_delete(vm_map_t *map) {
+  /* Page tables are about to vanish, so the map must not stay active. */
+  if (get_user_vm_map() == map)
+    vm_map_activate(NULL);
+
+  /* Other processors switch lazily, hence they may still refer to the map. */
+  for (unsigned i = 0; i < MAXCPU; i++)
+    if (_pcpu_data[i].uspace == map)
+      _pcpu_data[i].uspace = NULL;
+
+  WITH_MTX_LOCK (&vm_maps_lock)
+    TAILQ_REMOVE(&vm_maps, map, all);
+
+  /* Pages of all segments are released at once, once the map is gone. */
+  pg_list_t pages;
+  TAILQ_INIT(&pages);
+
   WITH_MTX_LOCK (&map->mtx) {
     vm_segment_t *seg;
     while ((seg = TAILQ_FIRST(&map->entries))) {
       vm_map_remove_segment(map, seg);
-      vm_segment_free(seg);
+      if (seg->object)
+        vm_object_destroy(seg->object, &pages);
+      pool_free(P_VMENTRY, seg);
     }
   }
+
   pmap_delete(map->pmap);
+  pm_free_list(&pages);
   pool_free(P_VMMAP, map);
 }
 
-/* TODO: not implemented */
-void vm_map_protect(vm_map_t *map, vaddr_t start, vaddr_t end, vm_prot_t prot) {
+/* Splits the segment at @addr. Pages backing the part above @addr are moved to
+ * a new object, which is owned by newly created segment. Returns the latter. */
+static vm_segment_t *vm_segment_split(vm_map_t *map, vm_segment_t *seg,
+                                      vaddr_t addr) {
+  assert(mtx_owned(&map->mtx));
+  assert(is_aligned(addr, PAGESIZE));
+  assert(seg->start < addr && addr < seg->end);
+
+  vm_object_t *obj = vm_object_split(seg->object, vm_segment_offset(seg, addr));
+  vm_segment_t *tail = vm_segment_alloc(obj, addr, seg->end, seg->prot);
+  tail->advice = seg->advice;
+  /* Only the part at the bottom of a stack may grow. */
+  tail->flags = seg->flags & ~VM_STACK;
+  seg->end = addr;
+  vm_map_insert_after(map, seg, tail);
+  return tail;
+}
+
+/* Splits segments crossing boundaries of [start, end) range, so that the range
+ * is covered by whole segments only. Returns the first of them or NULL. */
+static vm_segment_t *vm_map_clip(vm_map_t *map, vaddr_t start, vaddr_t end) {
+  assert(mtx_owned(&map->mtx));
+
+  vm_segment_t *first = NULL, *it;
+  TAILQ_FOREACH (it, &map->entries, link) {
+    if (it->end <= start)
+      continue;
+    if (it->start >= end)
+      break;
+    if (it->start < start)
+      it = vm_segment_split(map, it, start);
+    if (it->end > end)
+      vm_segment_split(map, it, end);
+    if (first == NULL)
+      first = it;
+  }
+  return first;
+}
+
+int vm_map_remove(vm_map_t *map, vaddr_t start, vaddr_t end) {
+  assert(is_aligned(start, PAGESIZE) && is_aligned(end, PAGESIZE));
+
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg, *next;
+  for (seg = vm_map_clip(map, start, end); seg && seg->start < end;
+       seg = next) {
+    next = TAILQ_NEXT(seg, link);
+    klog("Unmap segment %08lx - %08lx", seg->start, seg->end);
+    vm_map_remove_segment(map, seg);
+    pmap_remove(map->pmap, seg->start, seg->end);
+    vm_segment_free(seg);
+  }
+
+  return 0;
+}
+
+int vm_map_protect(vm_map_t *map, vaddr_t start, vaddr_t end, vm_prot_t prot) {
+  assert(is_aligned(start, PAGESIZE) && is_aligned(end, PAGESIZE));
+
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg;
+  for (seg = vm_map_clip(map, start, end); seg && seg->start < end;
+       seg = TAILQ_NEXT(seg, link)) {
+    seg->prot = prot;
+    pmap_protect(map->pmap, seg->start, seg->end, prot);
+  }
+
+  return 0;
 }
 
 static int vm_map_findspace_nolock(vm_map_t *map, vaddr_t /*inout*/ *start_p,
@@ -215,6 +328,11 @@ int vm_map_insert(vm_map_t *map, vm_segment_t *seg, vm_flags_t flags) {
     return -ENOMEM;
   seg->start = start;
   seg->end = start + length;
+  seg->flags = flags & VM_STACK;
+  /* Stack grows down from its top, which never moves. Counting offsets of its
+   * object from the lowest address the stack could ever reach means growth
+   * leaves them as they are. */
+  seg->origin = (flags & VM_STACK) ? map->pmap->start : start;
   vm_map_insert_after(map, after, seg);
   return 0;
 }
@@ -224,24 +342,19 @@ int vm_map_resize(vm_map_t *map, vm_segment_t *seg, vaddr_t new_end) {
 
   SCOPED_MTX_LOCK(&map->mtx);
 
-  /* TODO: As for now, we are unable to decrease the size of an entry, because
-     it would require unmapping physical pages, which in turn should clean
-     TLB. This is not implemented yet, and therefore shrinking an entry
-     immediately leads to very confusing behavior, as the vm_map and TLB entries
-     do not match. */
-  assert(new_end >= seg->end);
-
   if (new_end > seg->end) {
     /* Expanding entry */
     vm_segment_t *next = TAILQ_NEXT(seg, link);
     vaddr_t gap_end = next ? next->start : map->pmap->end;
     if (new_end > gap_end)
       return -ENOMEM;
-  } else {
+  } else if (new_end < seg->end) {
     /* Shrinking entry */
     if (new_end < seg->start)
       return -ENOMEM;
-    /* TODO: Invalidate tlb? */
+    pmap_remove(map->pmap, new_end, seg->end);
+    vm_object_remove_range(seg->object, vm_segment_offset(seg, new_end),
+                           vm_segment_offset(seg, seg->end));
   }
   /* Note that tailq does not require updating. */
   seg->end = new_end;
@@ -274,6 +387,9 @@ vm_map_t *vm_map_clone(vm_map_t *map) {
     TAILQ_FOREACH (it, &map->entries, link) {
       vm_object_t *obj = vm_object_clone(it->object);
       vm_segment_t *seg = vm_segment_alloc(obj, it->start, it->end, it->prot);
+      seg->flags = it->flags;
+      seg->advice = it->advice;
+      seg->origin = it->origin;
       TAILQ_INSERT_TAIL(&new_map->entries, seg, link);
       new_map->nentries++;
     }
@@ -282,8 +398,215 @@ vm_map_t *vm_map_clone(vm_map_t *map) {
   return new_map;
 }
 
+/* Hands over physical run @pg to the object page by page, so that it can be
+ * freed piecemeal. Buddy system will coalesce it back. */
+static void vm_object_add_run(vm_object_t *obj, off_t offset, vm_page_t *pg) {
+  while (pg->size > 1) {
+    vm_page_t *buddy = pm_split_alloc_page(pg);
+    vm_object_add_run(obj, offset + PG_SIZE(pg), buddy);
+  }
+  vm_object_add_page(obj, offset, pg);
+}
+
+/* Anonymous memory faults try to back a whole superpage window (2 * size
+ * bytes) with an aligned physical run, so pmap can use large TLB entries.
+ * Sizes are powers of 4 of PAGESIZE, as required by PageMask register. */
+#define VM_LPAGE_MIN (16 * 1024)
+#define VM_LPAGE_MAX (64 * 1024)
+
+static bool vm_page_fault_large(vm_map_t *map, vm_segment_t *seg,
+                                vaddr_t fault_page) {
+  vm_object_t *obj = seg->object;
+
+  if (obj->pager->pgr_type != VM_ANONYMOUS)
+    return false;
+
+  for (size_t size = VM_LPAGE_MAX; size >= VM_LPAGE_MIN; size /= 4) {
+    vaddr_t start = fault_page & -(2 * size);
+    vaddr_t end = start + 2 * size;
+
+    if (start < seg->start || end > seg->end)
+      continue;
+
+    off_t offset = vm_segment_offset(seg, start);
+    if (!vm_object_range_empty(obj, offset, offset + 2 * size))
+      continue;
+
+    vm_page_t *pg = pm_alloc(2 * size / PAGESIZE);
+    if (pg == NULL)
+      continue;
+
+    /* Buddy blocks are aligned only relatively to physical segment start. */
+    if (!is_aligned(PG_START(pg), size)) {
+      pm_free(pg);
+      continue;
+    }
+
+    pmap_zero_page(pg);
+    pmap_enter(map->pmap, start, pg, seg->prot);
+    vm_object_add_run(obj, offset, pg);
+
+    klog("Backed %08lx-%08lx with large pages", start, end);
+    return true;
+  }
+
+  return false;
+}
+
+/* Largest run of pages allocated at once while populating a range. */
+#define VM_POPULATE_MAX 16
+
+/* Number of pages mapped ahead of a fault in sequentially accessed segment. */
+#define VM_FAULT_AHEAD 16
+
+/* Checks if page at @offset is resident or was moved out to swap. */
+static bool vm_object_page_present(vm_object_t *obj, off_t offset) {
+  return vm_object_find_page(obj, offset) || swap_has_page(obj, offset);
+}
+
+/* Backs nonresident pages of [start, end) range of anonymous segment with
+ * zero-filled frames. Runs of missing pages are allocated in as large chunks
+ * as possible and entered into pmap at once, instead of taking a page fault
+ * for each of them. */
+static void vm_segment_populate(vm_map_t *map, vm_segment_t *seg,
+                                vaddr_t start, vaddr_t end) {
+  vm_object_t *obj = seg->object;
+
+  if (obj->pager->pgr_type != VM_ANONYMOUS || seg->prot == VM_PROT_NONE)
+    return;
+
+  for (vaddr_t va = start; va < end;) {
+    off_t offset = vm_segment_offset(seg, va);
+
+    if (vm_object_page_present(obj, offset)) {
+      va += PAGESIZE;
+      continue;
+    }
+
+    unsigned n = 1;
+    while (n < VM_POPULATE_MAX && va + n * PAGESIZE < end &&
+           !vm_object_page_present(obj, offset + n * PAGESIZE))
+      n++;
+
+    /* Buddy system hands out runs of power of two pages only. */
+    unsigned npages = 1 << (31 - clz(n));
+    vm_page_t *pg;
+    while ((pg = pm_alloc(npages)) == NULL && npages > 1)
+      npages /= 2;
+    /* Remaining pages will be brought in by page faults. */
+    if (pg == NULL)
+      return;
+
+    pmap_zero_page(pg);
+    pmap_enter(map->pmap, va, pg, seg->prot);
+    vm_object_add_run(obj, offset, pg);
+    va += npages * PAGESIZE;
+  }
+}
+
+int vm_map_advise(vm_map_t *map, vaddr_t start, vaddr_t end, int advice) {
+  assert(is_aligned(start, PAGESIZE) && is_aligned(end, PAGESIZE));
+
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg;
+
+  if (advice == MADV_NORMAL || advice == MADV_SEQUENTIAL) {
+    for (seg = vm_map_clip(map, start, end); seg && seg->start < end;
+         seg = TAILQ_NEXT(seg, link))
+      seg->advice = advice;
+    return 0;
+  }
+
+  TAILQ_FOREACH (seg, &map->entries, link) {
+    if (seg->end <= start)
+      continue;
+    if (seg->start >= end)
+      break;
+
+    vaddr_t s = max(start, seg->start);
+    vaddr_t e = min(end, seg->end);
+
+    if (advice == MADV_DONTNEED) {
+      /* Mapping stays, next access will bring in a fresh page. */
+      pmap_remove(map->pmap, s, e);
+      vm_object_remove_range(seg->object, vm_segment_offset(seg, s),
+                             vm_segment_offset(seg, e));
+    } else if (advice == MADV_WILLNEED) {
+      vm_segment_populate(map, seg, s, e);
+    } else {
+      return -EINVAL;
+    }
+  }
+
+  return 0;
+}
+
+int vm_map_resident(vm_map_t *map, vaddr_t start, vaddr_t end, uint8_t *vec) {
+  assert(is_aligned(start, PAGESIZE) && is_aligned(end, PAGESIZE));
+
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg = TAILQ_FIRST(&map->entries);
+
+  for (vaddr_t va = start; va < end; va += PAGESIZE) {
+    while (seg && seg->end <= va)
+      seg = TAILQ_NEXT(seg, link);
+    if (seg == NULL || va < seg->start)
+      return -ENOMEM;
+    vec[(va - start) / PAGESIZE] =
+      vm_object_find_page(seg->object, vm_segment_offset(seg, va)) != NULL;
+  }
+
+  return 0;
+}
+
+/* Stack segments are extended downwards in chunks of that size. */
+#define VM_STACK_GROW (64 * 1024)
+
+/* Stack must not grow closer than that to the segment below it. */
+#define VM_STACK_GUARD (64 * 1024)
+
+/* Tries to extend stack segment lying above @addr, so that it covers @addr,
+ * but doesn't exceed @limit bytes in size. Returns the segment on success. */
+static vm_segment_t *vm_map_grow_stack(vm_map_t *map, vaddr_t addr,
+                                       size_t limit) {
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg, *prev = NULL;
+  TAILQ_FOREACH (seg, &map->entries, link) {
+    if (seg->start > addr)
+      break;
+    prev = seg;
+  }
+
+  if (seg == NULL || !(seg->flags & VM_STACK))
+    return NULL;
+
+  vaddr_t start = rounddown(addr, VM_STACK_GROW);
+  if (seg->end - start > limit)
+    start = seg->end - rounddown(limit, PAGESIZE);
+  if (prev && start < prev->end + VM_STACK_GUARD)
+    start = prev->end + VM_STACK_GUARD;
+  if (addr < start || start >= seg->start)
+    return NULL;
+
+  klog("Grow stack segment %08lx - %08lx down to %08lx", seg->start, seg->end,
+       start);
+
+  /* Object offsets are counted from fixed origin, so pages stay in place. */
+  seg->start = start;
+  return seg;
+}
+
 int vm_page_fault(vm_map_t *map, vaddr_t fault_addr, vm_prot_t fault_type) {
   vm_segment_t *seg = vm_map_find_segment(map, fault_addr);
+  proc_t *p = proc_self();
+
+  if (!seg && p && p->p_uspace == map) {
+    rlim_t limit = p->p_rlimit[RLIMIT_STACK].rlim_cur;
+    seg = vm_map_grow_stack(map, fault_addr, limit);
+  }
 
   if (!seg) {
     klog("Tried to access unmapped memory region: 0x%08lx!", fault_addr);
@@ -312,9 +635,16 @@ int vm_page_fault(vm_map_t *map, vaddr_t fault_addr, vm_prot_t fault_type) {
   assert(obj != NULL);
 
   vaddr_t fault_page = fault_addr & -PAGESIZE;
-  vaddr_t offset = fault_page - seg->start;
+  off_t offset = vm_segment_offset(seg, fault_page);
   vm_page_t *frame = vm_object_find_page(seg->object, offset);
 
+  if (p && p->p_uspace == map)
+    WITH_MTX_LOCK (&p->p_lock)
+      p->p_minflt++;
+
+  if (frame == NULL && vm_page_fault_large(map, seg, fault_page))
+    return 0;
+
   if (frame == NULL)
     frame = obj->pager->pgr_fault(obj, offset);
 
@@ -323,7 +653,117 @@ int vm_page_fault(vm_map_t *map, vaddr_t fault_addr, vm_prot_t fault_type) {
 
   pmap_enter(map->pmap, fault_page, frame, seg->prot);
 
+  if (seg->advice == MADV_SEQUENTIAL) {
+    vaddr_t end = min(fault_page + (VM_FAULT_AHEAD + 1) * PAGESIZE, seg->end);
+    WITH_MTX_LOCK (&map->mtx)
+      vm_segment_populate(map, seg, fault_page + PAGESIZE, end);
+  }
+
+  return 0;
+}
+
+/* Sets *pgp to resident page backing @vaddr, or NULL if there is none. The
+ * page is held, so that it stays valid after the map gets unlocked. */
+static int vm_map_hold_page(vm_map_t *map, vaddr_t vaddr, vm_prot_t access,
+                            vm_page_t **pgp) {
+  SCOPED_MTX_LOCK(&map->mtx);
+
+  vm_segment_t *seg = vm_map_lookup_segment(map, vaddr);
+  vm_page_t *pg = NULL;
+
+  if (seg) {
+    if ((seg->prot & access) != access)
+      return -EACCES;
+    pg = vm_object_find_page(seg->object,
+                             vm_segment_offset(seg, vaddr & -PAGESIZE));
+    if (pg)
+      vm_page_hold(pg);
+  }
+
+  *pgp = pg;
   return 0;
 }
 
+int vm_map_lookup_page(vm_map_t *map, vaddr_t vaddr, vm_prot_t access,
+                       vm_page_t **pgp) {
+  int error = vm_map_hold_page(map, vaddr, access, pgp);
+  if (error || *pgp)
+    return error;
+
+  if ((error = vm_page_fault(map, vaddr, access)))
+    return error;
+
+  /* Stack segment might have grown, so look it up again. */
+  if ((error = vm_map_hold_page(map, vaddr, access, pgp)))
+    return error;
+  return *pgp ? 0 : -EFAULT;
+}
+
+void vm_map_release_page(vm_map_t *map, vm_page_t *pg) {
+  SCOPED_MTX_LOCK(&map->mtx);
+  vm_page_unhold(pg);
+}
+
+/* Moves out up to @npages resident pages of anonymous segments of @map.
+ * As no page access history is kept, victims are picked in address order. */
+static size_t vm_map_pageout_segments(vm_map_t *map, size_t npages) {
+  assert(mtx_owned(&map->mtx));
+
+  size_t count = 0;
+  vm_segment_t *seg;
+
+  TAILQ_FOREACH (seg, &map->entries, link) {
+    vm_object_t *obj = seg->object;
+
+    if (obj->pager->pgr_type != VM_ANONYMOUS)
+      continue;
+
+    vm_page_t *pg;
+    off_t offset = 0;
+
+    while (count < npages && (pg = vm_object_next_page(obj, offset))) {
+      vaddr_t va = seg->origin + pg->offset;
+      offset = pg->offset + PAGESIZE;
+      /* Someone is accessing the page through a kernel mapping. */
+      if (pg->hold_count)
+        continue;
+      pmap_remove(map->pmap, va, va + PAGESIZE);
+      if (!swap_pageout(obj, pg)) {
+        /* Swap space is exhausted, so the page has to stay. */
+        pmap_enter(map->pmap, va, pg, seg->prot);
+        return count;
+      }
+      count++;
+    }
+  }
+
+  return count;
+}
+
+size_t vm_map_pageout(size_t npages) {
+  SCOPED_MTX_LOCK(&vm_maps_lock);
+
+  if (swap_available() == 0)
+    return 0;
+
+  size_t count = 0;
+  vm_map_t *last = TAILQ_LAST(&vm_maps, vm_map_head);
+
+  while (count < npages && !TAILQ_EMPTY(&vm_maps)) {
+    /* Next time pageout will start with the map following this one. */
+    vm_map_t *map = TAILQ_FIRST(&vm_maps);
+    TAILQ_REMOVE(&vm_maps, map, all);
+    TAILQ_INSERT_TAIL(&vm_maps, map, all);
+
+    WITH_MTX_LOCK (&map->mtx)
+      count += vm_map_pageout_segments(map, npages - count);
+
+    if (map == last)
+      break;
+  }
+
+  klog("Moved out %ld pages to swap", count);
+  return count;
+}
+
 SYSINIT_ADD(vm_map, vm_map_init, NODEPS);
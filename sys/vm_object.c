@@ -3,88 +3,149 @@
 #include <pool.h>
 #include <pmap.h>
 #include <physmem.h>
+#include <swap.h>
 #include <vm_object.h>
 
 static POOL_DEFINE(P_VMOBJ, "vm_object", sizeof(vm_object_t));
 
-static inline int vm_page_cmp(vm_page_t *a, vm_page_t *b) {
-  if (a->offset < b->offset)
-    return -1;
-  return a->offset - b->offset;
-}
-
-RB_PROTOTYPE_STATIC(pg_tree, vm_page, obj.tree, vm_page_cmp);
-RB_GENERATE(pg_tree, vm_page, obj.tree, vm_page_cmp);
-
 vm_object_t *vm_object_alloc(vm_pgr_type_t type) {
   vm_object_t *obj = pool_alloc(P_VMOBJ, PF_ZERO);
-  TAILQ_INIT(&obj->list);
-  RB_INIT(&obj->tree);
+  vm_radix_init(&obj->pages);
+  TAILQ_INIT(&obj->swap);
   obj->pager = &pagers[type];
   return obj;
 }
 
-void vm_object_free(vm_object_t *obj) {
-  while (!TAILQ_EMPTY(&obj->list)) {
-    vm_page_t *pg = TAILQ_FIRST(&obj->list);
-    TAILQ_REMOVE(&obj->list, pg, obj.list);
-    pm_free(pg);
+vm_page_t *vm_object_next_page(vm_object_t *obj, off_t offset) {
+  return vm_radix_lookup_ge(&obj->pages, OFF_TO_IDX(offset));
+}
+
+#define vm_object_foreach_page(obj, pg, start)                                 \
+  for (pg = vm_object_next_page((obj), (start)); pg != NULL;                   \
+       pg = vm_object_next_page((obj), pg->offset + PAGESIZE))
+
+void vm_object_destroy(vm_object_t *obj, pg_list_t *pages) {
+  pg_list_t list;
+  TAILQ_INIT(&list);
+  vm_radix_drain(&obj->pages, &list);
+
+  vm_page_t *pg;
+  while ((pg = TAILQ_FIRST(&list))) {
+    TAILQ_REMOVE(&list, pg, pageq);
+    pg->object = NULL;
+    pg->offset = 0;
+    if (pg->hold_count)
+      pg->vm_flags |= VM_ORPHAN;
+    else
+      TAILQ_INSERT_TAIL(pages, pg, pageq);
   }
+  swap_free_object(obj);
   pool_free(P_VMOBJ, obj);
 }
 
+void vm_object_free(vm_object_t *obj) {
+  pg_list_t pages;
+  TAILQ_INIT(&pages);
+  vm_object_destroy(obj, &pages);
+  pm_free_list(&pages);
+}
+
 vm_page_t *vm_object_find_page(vm_object_t *obj, off_t offset) {
-  vm_page_t find = {.offset = offset};
-  return RB_FIND(pg_tree, &obj->tree, &find);
+  return vm_radix_lookup(&obj->pages, OFF_TO_IDX(offset));
+}
+
+bool vm_object_range_empty(vm_object_t *obj, off_t start, off_t end) {
+  vm_page_t *pg = vm_object_next_page(obj, start);
+  if (pg && pg->offset < end)
+    return false;
+  return swap_range_empty(obj, start, end);
 }
 
 bool vm_object_add_page(vm_object_t *obj, off_t offset, vm_page_t *page) {
-  assert(is_aligned(page->offset, PAGESIZE));
+  assert(is_aligned(offset, PAGESIZE));
   /* For simplicity of implementation let's insert pages of size 1 only */
   assert(page->size == 1);
 
+  if (!vm_radix_insert(&obj->pages, OFF_TO_IDX(offset), page))
+    return false;
+
   page->object = obj;
   page->offset = offset;
-
-  if (!RB_INSERT(pg_tree, &obj->tree, page)) {
-    obj->npages++;
-    vm_page_t *next = RB_NEXT(pg_tree, &obj->tree, page);
-    if (next)
-      TAILQ_INSERT_BEFORE(next, page, obj.list);
-    else
-      TAILQ_INSERT_TAIL(&obj->list, page, obj.list);
-    return true;
-  }
-
-  return false;
+  obj->npages++;
+  return true;
 }
 
-void vm_object_remove_page(vm_object_t *obj, vm_page_t *page) {
+/* Detaches the page from the object without releasing it. */
+static void vm_object_take_page(vm_object_t *obj, vm_page_t *page) {
+  vm_page_t *found = vm_radix_remove(&obj->pages, OFF_TO_IDX(page->offset));
+  assert(found == page);
   page->offset = 0;
   page->object = NULL;
-
-  TAILQ_REMOVE(&obj->list, page, obj.list);
-  RB_REMOVE(pg_tree, &obj->tree, page);
-  pm_free(page);
   obj->npages--;
 }
 
+void vm_object_remove_page(vm_object_t *obj, vm_page_t *page) {
+  vm_object_take_page(obj, page);
+  if (page->hold_count)
+    page->vm_flags |= VM_ORPHAN;
+  else
+    pm_free(page);
+}
+
+void vm_object_remove_range(vm_object_t *obj, off_t start, off_t end) {
+  vm_page_t *pg;
+  off_t offset = start;
+  while ((pg = vm_object_next_page(obj, offset)) && pg->offset < end) {
+    offset = pg->offset + PAGESIZE;
+    vm_object_remove_page(obj, pg);
+  }
+  swap_free_range(obj, start, end);
+}
+
+vm_object_t *vm_object_split(vm_object_t *obj, off_t offset) {
+  vm_object_t *new_obj = vm_object_alloc(obj->pager->pgr_type);
+
+  vm_page_t *pg;
+  while ((pg = vm_object_next_page(obj, offset))) {
+    off_t pg_offset = pg->offset;
+    vm_object_take_page(obj, pg);
+    vm_object_add_page(new_obj, pg_offset - offset, pg);
+  }
+  swap_split(obj, new_obj, offset);
+
+  return new_obj;
+}
+
 vm_object_t *vm_object_clone(vm_object_t *obj) {
   vm_object_t *new_obj = vm_object_alloc(VM_DUMMY);
   new_obj->pager = obj->pager;
 
   vm_page_t *pg;
-  TAILQ_FOREACH (pg, &obj->list, obj.list) {
+  vm_object_foreach_page(obj, pg, 0) {
     vm_page_t *new_pg = pm_alloc(1);
     pmap_copy_page(pg, new_pg);
     vm_object_add_page(new_obj, pg->offset, new_pg);
   }
+  swap_clone(obj, new_obj);
 
   return new_obj;
 }
 
 void vm_map_object_dump(vm_object_t *obj) {
   vm_page_t *it;
-  RB_FOREACH (it, pg_tree, &obj->tree)
+  vm_object_foreach_page(obj, it, 0)
     klog("(vm-obj) offset: 0x%08lx, size: %ld", it->offset, it->size);
 }
+
+void vm_page_hold(vm_page_t *pg) {
+  pg->hold_count++;
+}
+
+void vm_page_unhold(vm_page_t *pg) {
+  assert(pg->hold_count > 0);
+
+  if (--pg->hold_count == 0 && (pg->vm_flags & VM_ORPHAN)) {
+    pg->vm_flags &= ~VM_ORPHAN;
+    pm_free(pg);
+  }
+}
@@ -1,9 +1,14 @@
 #include <stdc.h>
 #include <physmem.h>
 #include <pmap.h>
+#include <swap.h>
+#include <vm_map.h>
 #include <vm_object.h>
 #include <vm_pager.h>
 
+/* Number of pages reclaimed at once when memory runs out. */
+#define VM_PAGEOUT_BATCH 16
+
 static vm_page_t *dummy_pager_fault(vm_object_t *obj, off_t offset) {
   return NULL;
 }
@@ -12,12 +17,24 @@ static vm_page_t *anon_pager_fault(vm_object_t *obj, off_t offset) {
   assert(obj != NULL);
 
   vm_page_t *new_pg = pm_alloc(1);
-  pmap_zero_page(new_pg);
+
+  /* Make room by releasing cached page tables first, then by moving out some
+   * pages of anonymous objects to swap. */
+  if (new_pg == NULL && pmap_reclaim() > 0)
+    new_pg = pm_alloc(1);
+  if (new_pg == NULL && vm_map_pageout(VM_PAGEOUT_BATCH) > 0)
+    new_pg = pm_alloc(1);
+
+  if (new_pg == NULL)
+    return NULL;
+
+  if (!swap_pagein(obj, offset, new_pg))
+    pmap_zero_page(new_pg);
   vm_object_add_page(obj, offset, new_pg);
   return new_pg;
 }
 
 vm_pager_t pagers[] = {
-    [VM_DUMMY] = {.pgr_fault = dummy_pager_fault},
-    [VM_ANONYMOUS] = {.pgr_fault = anon_pager_fault},
+    [VM_DUMMY] = {.pgr_type = VM_DUMMY, .pgr_fault = dummy_pager_fault},
+    [VM_ANONYMOUS] = {.pgr_type = VM_ANONYMOUS, .pgr_fault = anon_pager_fault},
 };
@@ -0,0 +1,153 @@
+#include <pool.h>
+#include <vm_radix.h>
+
+/* Slots of bottom level nodes point at pages, all other at child nodes. */
+struct vm_radix_node {
+  void *slots[VM_RADIX_SLOTS];
+  unsigned count; /* number of occupied slots */
+};
+
+static POOL_DEFINE(P_VMRADIX, "vm_radix_node", sizeof(vm_radix_node_t));
+
+static inline unsigned slot_index(vm_pindex_t idx, unsigned level) {
+  return (idx >> ((level - 1) * VM_RADIX_SHIFT)) & VM_RADIX_MASK;
+}
+
+/* Checks if the index can be reached in a trie of given height. */
+static inline bool index_fits(vm_pindex_t idx, unsigned height) {
+  if (height >= VM_RADIX_MAXHEIGHT)
+    return true;
+  return (idx >> (height * VM_RADIX_SHIFT)) == 0;
+}
+
+void vm_radix_init(vm_radix_t *rt) {
+  rt->root = NULL;
+  rt->height = 0;
+}
+
+bool vm_radix_insert(vm_radix_t *rt, vm_pindex_t idx, vm_page_t *pg) {
+  assert(pg != NULL);
+
+  if (rt->root == NULL) {
+    rt->root = pool_alloc(P_VMRADIX, PF_ZERO);
+    rt->height = 1;
+    while (!index_fits(idx, rt->height))
+      rt->height++;
+  }
+
+  /* Put a new root above the old one until the index fits. */
+  while (!index_fits(idx, rt->height)) {
+    vm_radix_node_t *node = pool_alloc(P_VMRADIX, PF_ZERO);
+    node->slots[0] = rt->root;
+    node->count = 1;
+    rt->root = node;
+    rt->height++;
+  }
+
+  vm_radix_node_t *node = rt->root;
+  for (unsigned level = rt->height; level > 1; level--) {
+    unsigned i = slot_index(idx, level);
+    if (node->slots[i] == NULL) {
+      node->slots[i] = pool_alloc(P_VMRADIX, PF_ZERO);
+      node->count++;
+    }
+    node = node->slots[i];
+  }
+
+  unsigned i = slot_index(idx, 1);
+  if (node->slots[i] != NULL)
+    return false;
+  node->slots[i] = pg;
+  node->count++;
+  return true;
+}
+
+vm_page_t *vm_radix_remove(vm_radix_t *rt, vm_pindex_t idx) {
+  if (rt->root == NULL || !index_fits(idx, rt->height))
+    return NULL;
+
+  vm_radix_node_t *path[VM_RADIX_MAXHEIGHT];
+  vm_radix_node_t *node = rt->root;
+  unsigned depth = 0;
+
+  for (unsigned level = rt->height; level > 1; level--) {
+    path[depth++] = node;
+    node = node->slots[slot_index(idx, level)];
+    if (node == NULL)
+      return NULL;
+  }
+  path[depth++] = node;
+
+  vm_page_t *pg = node->slots[slot_index(idx, 1)];
+  if (pg == NULL)
+    return NULL;
+
+  /* Clear the slot and release nodes that became empty, bottom up. */
+  for (unsigned level = 1; level <= rt->height; level++) {
+    node = path[depth - level];
+    node->slots[slot_index(idx, level)] = NULL;
+    if (--node->count > 0)
+      break;
+    pool_free(P_VMRADIX, node);
+    if (node == rt->root)
+      vm_radix_init(rt);
+  }
+
+  return pg;
+}
+
+vm_page_t *vm_radix_lookup(vm_radix_t *rt, vm_pindex_t idx) {
+  if (rt->root == NULL || !index_fits(idx, rt->height))
+    return NULL;
+
+  vm_radix_node_t *node = rt->root;
+  for (unsigned level = rt->height; level > 1; level--) {
+    node = node->slots[slot_index(idx, level)];
+    if (node == NULL)
+      return NULL;
+  }
+  return node->slots[slot_index(idx, 1)];
+}
+
+static vm_page_t *lookup_ge(vm_radix_node_t *node, unsigned level,
+                            vm_pindex_t idx) {
+  for (unsigned i = slot_index(idx, level); i < VM_RADIX_SLOTS; i++) {
+    void *slot = node->slots[i];
+    if (slot != NULL) {
+      if (level == 1)
+        return slot;
+      vm_page_t *pg = lookup_ge(slot, level - 1, idx);
+      if (pg != NULL)
+        return pg;
+    }
+    /* Every index below following slots is greater than the one looked for,
+     * so their subtrees have to be searched from the beginning. */
+    idx = 0;
+  }
+  return NULL;
+}
+
+vm_page_t *vm_radix_lookup_ge(vm_radix_t *rt, vm_pindex_t idx) {
+  if (rt->root == NULL || !index_fits(idx, rt->height))
+    return NULL;
+  return lookup_ge(rt->root, rt->height, idx);
+}
+
+static void drain(vm_radix_node_t *node, unsigned level, pg_list_t *pages) {
+  for (unsigned i = 0; i < VM_RADIX_SLOTS; i++) {
+    void *slot = node->slots[i];
+    if (slot == NULL)
+      continue;
+    if (level == 1)
+      TAILQ_INSERT_TAIL(pages, (vm_page_t *)slot, pageq);
+    else
+      drain(slot, level - 1, pages);
+  }
+  pool_free(P_VMRADIX, node);
+}
+
+void vm_radix_drain(vm_radix_t *rt, pg_list_t *pages) {
+  if (rt->root)
+    drain(rt->root, rt->height, pages);
+  vm_radix_init(rt);
+}
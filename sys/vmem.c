@@ -0,0 +1,279 @@
+#define KL_LOG KL_VM
+#include <klog.h>
+#include <stdc.h>
+#include <errno.h>
+#include <physmem.h>
+#include <vmem.h>
+
+#define BT_SPAN 1 /* marks beginning of a span, never coalesced */
+#define BT_FREE 2
+#define BT_BUSY 3
+
+struct bt {
+  TAILQ_ENTRY(bt) bt_seglink; /* all tags of an arena in address order */
+  LIST_ENTRY(bt) bt_link;     /* free list, hash chain or list of spare tags */
+  vmem_addr_t bt_start;
+  vmem_size_t bt_size;
+  int bt_type;
+};
+
+/* Boundary tags are carved out of directly mapped pages rather than taken from
+ * a pool, as pools get their memory from arenas built on top of this code. */
+static mtx_t bt_lock = MTX_INITIALIZER(MTX_DEF);
+static bt_list_t bt_spare = LIST_HEAD_INITIALIZER(bt_spare);
+
+static bt_t *bt_alloc(void) {
+  SCOPED_MTX_LOCK(&bt_lock);
+
+  if (LIST_EMPTY(&bt_spare)) {
+    vm_page_t *pg = pm_alloc(1);
+    if (pg == NULL)
+      return NULL;
+    bt_t *bt = PG_KSEG0_ADDR(pg);
+    for (unsigned i = 0; i < PAGESIZE / sizeof(bt_t); i++)
+      LIST_INSERT_HEAD(&bt_spare, &bt[i], bt_link);
+  }
+
+  bt_t *bt = LIST_FIRST(&bt_spare);
+  LIST_REMOVE(bt, bt_link);
+  return bt;
+}
+
+static void bt_free(bt_t *bt) {
+  SCOPED_MTX_LOCK(&bt_lock);
+  LIST_INSERT_HEAD(&bt_spare, bt, bt_link);
+}
+
+/* Index of the largest power of two not greater than @x. */
+static inline unsigned vmem_flsz(vmem_size_t x) {
+  return 31 - clz(x);
+}
+
+/* Free list of tags of size [2^i, 2^(i+1)) quanta. */
+static bt_list_t *bt_freehead_tofree(vmem_t *vm, vmem_size_t size) {
+  return &vm->vm_freelist[vmem_flsz(size >> vm->vm_quantum_shift)];
+}
+
+/* First free list that contains only tags of at least @size bytes. */
+static unsigned bt_freeidx_toalloc(vmem_t *vm, vmem_size_t size) {
+  vmem_size_t qsize = size >> vm->vm_quantum_shift;
+  unsigned idx = vmem_flsz(qsize);
+  return powerof2(qsize) ? idx : idx + 1;
+}
+
+static bt_list_t *bt_hashhead(vmem_t *vm, vmem_addr_t addr) {
+  return &vm->vm_hashlist[(addr >> vm->vm_quantum_shift) % VMEM_HASHSIZE];
+}
+
+static void bt_insfree(vmem_t *vm, bt_t *bt) {
+  bt->bt_type = BT_FREE;
+  LIST_INSERT_HEAD(bt_freehead_tofree(vm, bt->bt_size), bt, bt_link);
+}
+
+static void bt_insbusy(vmem_t *vm, bt_t *bt) {
+  bt->bt_type = BT_BUSY;
+  LIST_INSERT_HEAD(bt_hashhead(vm, bt->bt_start), bt, bt_link);
+  vm->vm_inuse += bt->bt_size;
+}
+
+static bt_t *bt_lookupbusy(vmem_t *vm, vmem_addr_t addr) {
+  bt_t *bt;
+  LIST_FOREACH (bt, bt_hashhead(vm, addr), bt_link)
+    if (bt->bt_start == addr)
+      return bt;
+  return NULL;
+}
+
+static bt_t *vmem_find_free(vmem_t *vm, vmem_size_t size) {
+  /* Instant fit: any tag from these lists is big enough. */
+  for (unsigned i = bt_freeidx_toalloc(vm, size); i < VMEM_MAXORDER; i++)
+    if (!LIST_EMPTY(&vm->vm_freelist[i]))
+      return LIST_FIRST(&vm->vm_freelist[i]);
+
+  /* Otherwise some tag on the list below may still fit. */
+  bt_t *bt;
+  LIST_FOREACH (bt, bt_freehead_tofree(vm, size), bt_link)
+    if (bt->bt_size >= size)
+      return bt;
+  return NULL;
+}
+
+static int vmem_xalloc(vmem_t *vm, vmem_size_t size, vmem_addr_t *addrp) {
+  assert(mtx_owned(&vm->vm_lock));
+
+  bt_t *bt = vmem_find_free(vm, size);
+  if (bt == NULL)
+    return -ENOMEM;
+
+  LIST_REMOVE(bt, bt_link);
+
+  if (bt->bt_size > size) {
+    /* Split the tag, front part gets allocated. */
+    bt_t *rest = bt_alloc();
+    if (rest == NULL) {
+      bt_insfree(vm, bt);
+      return -ENOMEM;
+    }
+    rest->bt_start = bt->bt_start + size;
+    rest->bt_size = bt->bt_size - size;
+    bt->bt_size = size;
+    TAILQ_INSERT_AFTER(&vm->vm_seglist, bt, rest, bt_seglink);
+    bt_insfree(vm, rest);
+  }
+
+  bt_insbusy(vm, bt);
+  *addrp = bt->bt_start;
+  return 0;
+}
+
+static void vmem_xfree(vmem_t *vm, vmem_addr_t addr, vmem_size_t size) {
+  assert(mtx_owned(&vm->vm_lock));
+
+  bt_t *bt = bt_lookupbusy(vm, addr);
+  if (bt == NULL)
+    panic("%s: freeing unallocated range %p", vm->vm_name, (void *)addr);
+  assert(bt->bt_size == size);
+
+  LIST_REMOVE(bt, bt_link);
+  vm->vm_inuse -= bt->bt_size;
+
+  /* Span markers are never free, so coalescing does not cross spans. */
+  bt_t *next = TAILQ_NEXT(bt, bt_seglink);
+  if (next != NULL && next->bt_type == BT_FREE) {
+    LIST_REMOVE(next, bt_link);
+    TAILQ_REMOVE(&vm->vm_seglist, next, bt_seglink);
+    bt->bt_size += next->bt_size;
+    bt_free(next);
+  }
+
+  bt_t *prev = TAILQ_PREV(bt, bt_seglist, bt_seglink);
+  if (prev->bt_type == BT_FREE) {
+    LIST_REMOVE(prev, bt_link);
+    TAILQ_REMOVE(&vm->vm_seglist, bt, bt_seglink);
+    prev->bt_size += bt->bt_size;
+    bt_free(bt);
+    bt = prev;
+  }
+
+  bt_insfree(vm, bt);
+}
+
+void vmem_init(vmem_t *vm, const char *name, vmem_size_t quantum,
+               vmem_size_t qcache_max) {
+  assert(quantum > 0 && powerof2(quantum));
+
+  bzero(vm, sizeof(vmem_t));
+  mtx_init(&vm->vm_lock, MTX_DEF);
+  vm->vm_name = name;
+  vm->vm_quantum = quantum;
+  vm->vm_quantum_shift = ctz(quantum);
+  vm->vm_nqcache = min(qcache_max / quantum, VMEM_QCACHE_MAX);
+
+  TAILQ_INIT(&vm->vm_seglist);
+  for (unsigned i = 0; i < VMEM_MAXORDER; i++)
+    LIST_INIT(&vm->vm_freelist[i]);
+  for (unsigned i = 0; i < VMEM_HASHSIZE; i++)
+    LIST_INIT(&vm->vm_hashlist[i]);
+}
+
+void vmem_destroy(vmem_t *vm) {
+  SCOPED_MTX_LOCK(&vm->vm_lock);
+
+  /* Return ranges held by quantum caches first. */
+  for (unsigned i = 0; i < vm->vm_nqcache; i++) {
+    vmem_qcache_t *qc = &vm->vm_qcache[i];
+    while (qc->qc_count > 0)
+      vmem_xfree(vm, qc->qc_items[--qc->qc_count], (i + 1) * vm->vm_quantum);
+  }
+
+  if (vm->vm_inuse > 0)
+    panic("%s: destroying arena with %ld bytes in use", vm->vm_name,
+          vm->vm_inuse);
+
+  bt_t *bt;
+  while ((bt = TAILQ_FIRST(&vm->vm_seglist))) {
+    TAILQ_REMOVE(&vm->vm_seglist, bt, bt_seglink);
+    bt_free(bt);
+  }
+}
+
+int vmem_add(vmem_t *vm, vmem_addr_t addr, vmem_size_t size) {
+  assert(is_aligned(addr, vm->vm_quantum));
+  assert(is_aligned(size, vm->vm_quantum));
+  assert(size > 0);
+
+  bt_t *span = bt_alloc();
+  bt_t *bt = bt_alloc();
+  if (span == NULL || bt == NULL) {
+    if (span)
+      bt_free(span);
+    return -ENOMEM;
+  }
+
+  span->bt_type = BT_SPAN;
+  span->bt_start = addr;
+  span->bt_size = size;
+  bt->bt_start = addr;
+  bt->bt_size = size;
+
+  SCOPED_MTX_LOCK(&vm->vm_lock);
+  TAILQ_INSERT_TAIL(&vm->vm_seglist, span, bt_seglink);
+  TAILQ_INSERT_TAIL(&vm->vm_seglist, bt, bt_seglink);
+  bt_insfree(vm, bt);
+  vm->vm_size += size;
+
+  klog("%s: added span %p-%p", vm->vm_name, (void *)addr,
+       (void *)(addr + size));
+  return 0;
+}
+
+int vmem_alloc(vmem_t *vm, vmem_size_t size, vmem_addr_t *addrp) {
+  assert(size > 0);
+
+  size = roundup(size, vm->vm_quantum);
+  unsigned qidx = (size >> vm->vm_quantum_shift) - 1;
+
+  SCOPED_MTX_LOCK(&vm->vm_lock);
+
+  if (qidx >= vm->vm_nqcache)
+    return vmem_xalloc(vm, size, addrp);
+
+  /* Refill an empty quantum cache with a batch of ranges at once. */
+  vmem_qcache_t *qc = &vm->vm_qcache[qidx];
+  if (qc->qc_count == 0) {
+    while (qc->qc_count < VMEM_QCACHE_SIZE / 2) {
+      vmem_addr_t addr;
+      if (vmem_xalloc(vm, size, &addr))
+        break;
+      qc->qc_items[qc->qc_count++] = addr;
+    }
+  }
+
+  if (qc->qc_count == 0)
+    return -ENOMEM;
+
+  *addrp = qc->qc_items[--qc->qc_count];
+  return 0;
+}
+
+void vmem_free(vmem_t *vm, vmem_addr_t addr, vmem_size_t size) {
+  assert(size > 0);
+
+  size = roundup(size, vm->vm_quantum);
+  unsigned qidx = (size >> vm->vm_quantum_shift) - 1;
+
+  SCOPED_MTX_LOCK(&vm->vm_lock);
+
+  if (qidx >= vm->vm_nqcache) {
+    vmem_xfree(vm, addr, size);
+    return;
+  }
+
+  /* Drain half of a full quantum cache back to the arena. */
+  vmem_qcache_t *qc = &vm->vm_qcache[qidx];
+  if (qc->qc_count == VMEM_QCACHE_SIZE)
+    while (qc->qc_count > VMEM_QCACHE_SIZE / 2)
+      vmem_xfree(vm, qc->qc_items[--qc->qc_count], size);
+
+  qc->qc_items[qc->qc_count++] = addr;
+}
@@ -119,8 +119,29 @@ static int test_callout_drain(void) {
   return KTEST_SUCCESS;
 }
 
+/* This test checks if the earliest pending callout is found. Other callouts
+ * may be pending in the system, so only an upper bound can be verified. */
+static int test_callout_next(void) {
+  callout_t callouts[2];
+  bzero(callouts, sizeof(callout_t) * 2);
+
+  systime_t now = getsystime();
+  callout_setup(&callouts[0], now + 1000, callout_bad, NULL);
+  callout_setup(&callouts[1], now + 500, callout_bad, NULL);
+
+  systime_t next;
+  bool found = callout_next(&next);
+  assert(found && next <= now + 500);
+
+  callout_stop(&callouts[0]);
+  callout_stop(&callouts[1]);
+
+  return KTEST_SUCCESS;
+}
+
 KTEST_ADD(callout_sync, test_callout_sync, 0);
 KTEST_ADD(callout_simple, test_callout_simple, 0);
 KTEST_ADD(callout_order, test_callout_order, 0);
 KTEST_ADD(callout_stop, test_callout_stop, 0);
 KTEST_ADD(callout_drain, test_callout_drain, 0);
+KTEST_ADD(callout_next, test_callout_next, 0);
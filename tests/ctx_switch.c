@@ -0,0 +1,92 @@
+#include <ktest.h>
+#include <stdc.h>
+#include <thread.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <runq.h>
+#include <vm_map.h>
+#include <mips/m32c0.h>
+
+#define YIELD_ROUNDS 1000
+#define YIELD_THREADS_MAX 32
+
+static void yield_thread(void *arg) {
+  for (int i = 0; i < YIELD_ROUNDS; i++)
+    thread_yield();
+}
+
+/* Starts a yielding thread for each of @n priorities and waits for all of them
+ * to finish. Returns average number of C0_COUNT ticks per context switch. */
+static uint32_t yield_threads_bench(unsigned n, const prio_t *prios) {
+  thread_t *threads[YIELD_THREADS_MAX];
+  unsigned nctxsw = 0;
+
+  assert(n <= YIELD_THREADS_MAX);
+
+  for (unsigned i = 0; i < n; i++) {
+    threads[i] = thread_create("yield thread", yield_thread, NULL);
+    WITH_SPINLOCK(threads[i]->td_spin) {
+      sched_set_prio(threads[i], prios[i]);
+    }
+  }
+
+  uint32_t start = mips32_getcount();
+  WITH_NO_PREEMPTION {
+    for (unsigned i = 0; i < n; i++)
+      sched_add(threads[i]);
+  }
+  for (unsigned i = 0; i < n; i++)
+    thread_join(threads[i]);
+  uint32_t ticks = mips32_getcount() - start;
+
+  for (unsigned i = 0; i < n; i++)
+    nctxsw += threads[i]->td_nctxsw;
+  assert(nctxsw >= n * (YIELD_ROUNDS - 1));
+
+  return ticks / nctxsw;
+}
+
+/* Reports average number of C0_COUNT ticks spent in a context switch between
+ * kernel threads. Such switches leave user space of previous thread loaded,
+ * so compare the result with the cost of reloading the address space. */
+static int test_ctx_switch_bench(void) {
+  static const prio_t prios[2] = {PRIO_KTHREAD, PRIO_KTHREAD};
+  uint32_t switch_ticks = yield_threads_bench(2, prios);
+
+  vm_map_t *orig = get_user_vm_map();
+  vm_map_t *map = vm_map_new();
+
+  uint32_t start = mips32_getcount();
+  for (int i = 0; i < YIELD_ROUNDS; i++) {
+    vm_map_activate(map);
+    vm_map_activate(orig);
+  }
+  uint32_t activate_ticks = mips32_getcount() - start;
+
+  vm_map_delete(map);
+
+  kprintf("context switch: %u ticks, user space switch: %u ticks\n",
+          switch_ticks, activate_ticks / YIELD_ROUNDS / 2);
+
+  return KTEST_SUCCESS;
+}
+
+/* Same as above, but with run queues spread across the whole priority range
+ * occupied. Threads are created in pairs, each pair with distinct priority.
+ * Partners of a pair alternate on the CPU until they finish, then next pair
+ * takes over. */
+static int test_sched_switch_bench(void) {
+  const unsigned npairs = YIELD_THREADS_MAX / 2;
+  prio_t prios[YIELD_THREADS_MAX];
+
+  for (unsigned i = 0; i < YIELD_THREADS_MAX; i++)
+    prios[i] = (i / 2 + 1) * (RQ_NQS / (npairs + 1)) * RQ_PPQ;
+
+  kprintf("sched_switch with %u queues occupied: %u ticks\n", npairs,
+          yield_threads_bench(YIELD_THREADS_MAX, prios));
+
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(ctx_switch_bench, test_ctx_switch_bench, 0);
+KTEST_ADD(sched_switch_bench, test_sched_switch_bench, 0);
@@ -48,6 +48,28 @@ static int test_physmem(void) {
   return KTEST_SUCCESS;
 }
 
+static int test_physmem_free_list(void) {
+  unsigned long pre = pm_hash();
+
+  /* Break a block into single pages, as if they were allocated one by one. */
+  const int N = 64;
+  vm_page_t *pg = pm_alloc(N);
+  for (int size = N; size > 1; size /= 2)
+    for (int i = 0; i < N; i += size)
+      pm_split_alloc_page(&pg[i]);
+
+  /* Put pages on the list in an order unrelated to their addresses. */
+  pg_list_t pages;
+  TAILQ_INIT(&pages);
+  for (int i = 0; i < N; i++)
+    TAILQ_INSERT_TAIL(&pages, &pg[(i * 37) % N], pageq);
+
+  pm_free_list(&pages);
+  assert(TAILQ_EMPTY(&pages));
+  assert(pre == pm_hash());
+  return KTEST_SUCCESS;
+}
+
 /* If I understand it correctly, this test is not guaranteed to be always
    successful. It relies on the pm_hash changing when allocations are
    done. However, if the kernel has been running for a while (or some other
@@ -56,3 +78,4 @@ static int test_physmem(void) {
    marked as BROKEN, and we may want to investigate alternative ways of testing
    physmem.*/
 KTEST_ADD(physmem, test_physmem, KTEST_FLAG_BROKEN);
+KTEST_ADD(physmem_free_list, test_physmem_free_list, 0);
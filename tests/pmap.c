@@ -1,7 +1,10 @@
 #include <pmap.h>
+#include <mips/pmap.h>
 #include <physmem.h>
 #include <vm.h>
 #include <ktest.h>
+#include <stdc.h>
+#include <mips/m32c0.h>
 
 #define PAGES 16
 
@@ -41,6 +44,60 @@ static int test_kernel_pmap(void) {
   return KTEST_SUCCESS;
 }
 
+#define LPAGES 64
+
+/* Large enough run will be mapped with large pages, which then have to be
+ * demoted on partial removal and partial protection change. */
+static int test_large_pmap(void) {
+  pmap_t *pmap = get_kernel_pmap();
+
+  vm_page_t *pg = pm_alloc(LPAGES);
+  size_t size = pg->size * PAGESIZE;
+
+  vaddr_t vaddr = pmap->start;
+  vaddr_t end = pmap->start + size;
+
+  pmap_enter(pmap, vaddr, pg, VM_PROT_READ | VM_PROT_WRITE);
+
+  unsigned *array = (void *)vaddr;
+  for (unsigned i = 0; i < size / sizeof(int); i++)
+    assert(try_store_word(&array[i], i));
+
+  /* Each half of a large page window, and each page within a half, must land
+   * in its own frame. Look at the frames through KSEG0. Virtual and physical
+   * addresses are both aligned to the window size, so the cache sees no
+   * aliases. */
+  unsigned *alias = PG_KSEG0_ADDR(pg);
+  for (unsigned i = 0; i < size / sizeof(int); i++)
+    assert(alias[i] == i);
+
+  /* Punch a hole in the middle of the mapping. */
+  vaddr_t hole = vaddr + size / 2 + PAGESIZE;
+  pmap_remove(pmap, hole, hole + PAGESIZE);
+
+  /* Make the first page read-only. */
+  pmap_protect(pmap, vaddr, vaddr + PAGESIZE, VM_PROT_READ);
+  assert(!try_store_word((void *)vaddr, 0));
+  assert(try_store_word((void *)(vaddr + PAGESIZE), PAGESIZE / sizeof(int)));
+
+  for (vaddr_t addr = vaddr; addr < end; addr += sizeof(int)) {
+    unsigned val;
+    if (addr >= hole && addr < hole + PAGESIZE) {
+      assert(!try_load_word((void *)addr, &val));
+    } else {
+      assert(try_load_word((void *)addr, &val));
+      assert(val == (addr - vaddr) / sizeof(int));
+      /* Demoted pages must still point to their own frames. */
+      assert(alias[(addr - vaddr) / sizeof(int)] == val);
+    }
+  }
+
+  pmap_remove(pmap, vaddr, end);
+  pm_free(pg);
+
+  return KTEST_SUCCESS;
+}
+
 static int test_user_pmap(void) {
   pmap_t *orig = get_user_pmap();
 
@@ -75,5 +132,208 @@ static int test_user_pmap(void) {
   return KTEST_SUCCESS;
 }
 
+static unsigned count_pte_pages(pmap_t *pmap) {
+  unsigned n = 0;
+  vm_page_t *pg;
+  TAILQ_FOREACH (pg, &pmap->pte_pages, pageq)
+    n++;
+  return n;
+}
+
+/* Unmapping a range must drop its TLB entries and release page tables that
+ * are left without any mappings. */
+static int test_remove_pmap(void) {
+  pmap_t *orig = get_user_pmap();
+  pmap_t *pmap = pmap_new();
+
+  /* Range spans three page tables. */
+  vaddr_t start = 0x1001000 - PT_ENTRIES * PAGESIZE;
+  vaddr_t end = start + 2 * PT_ENTRIES * PAGESIZE + PAGESIZE;
+
+  vm_page_t *pg = pm_alloc(1);
+
+  pmap_activate(pmap);
+  for (vaddr_t va = start; va < end; va += PT_ENTRIES * PAGESIZE / 4)
+    pmap_enter(pmap, va, pg, VM_PROT_READ | VM_PROT_WRITE);
+  pmap_enter(pmap, end - PAGESIZE, pg, VM_PROT_READ | VM_PROT_WRITE);
+  assert(count_pte_pages(pmap) == 3);
+
+  for (vaddr_t va = start; va < end; va += PT_ENTRIES * PAGESIZE / 4)
+    assert(try_store_word((void *)va, va));
+
+  /* Small range is invalidated per page, page tables stay in place. */
+  pmap_remove(pmap, start, start + PAGESIZE);
+  assert(!try_store_word((void *)start, 0));
+  assert(count_pte_pages(pmap) == 3);
+
+  /* Large range is flushed by ASID, emptied page tables go away. */
+  pmap_remove(pmap, start, end - PAGESIZE);
+  for (vaddr_t va = start; va < end - PAGESIZE;
+       va += PT_ENTRIES * PAGESIZE / 4)
+    assert(!try_store_word((void *)va, 0));
+  assert(count_pte_pages(pmap) == 1);
+
+  unsigned val;
+  assert(try_load_word((void *)(end - PAGESIZE), &val));
+
+  pmap_remove(pmap, end - PAGESIZE, end);
+  assert(count_pte_pages(pmap) == 0);
+
+  pmap_activate(NULL);
+  pmap_delete(pmap);
+  pm_free(pg);
+
+  /* Restore original user pmap */
+  pmap_activate(orig);
+
+  return KTEST_SUCCESS;
+}
+
+/* Number of address spaces exceeding number of available ASIDs. */
+#define NPMAPS 600
+
+/* Create more address spaces than there are ASIDs, which forces ASID
+ * generation rollover, and check the long-lived one keeps its contents. */
+static int test_asid_pmap(void) {
+  pmap_t *orig = get_user_pmap();
+
+  vaddr_t start = 0x1001000;
+  volatile int *ptr = (int *)start;
+
+  pmap_t *keep = pmap_new();
+  vm_page_t *keep_pg = pm_alloc(1);
+  pmap_activate(keep);
+  pmap_enter(keep, start, keep_pg, VM_PROT_READ | VM_PROT_WRITE);
+  *ptr = -1;
+
+  vm_page_t *pg = pm_alloc(1);
+
+  for (int i = 0; i < NPMAPS; i++) {
+    pmap_t *pmap = pmap_new();
+    pmap_activate(pmap);
+    pmap_enter(pmap, start, pg, VM_PROT_READ | VM_PROT_WRITE);
+    *ptr = i;
+    pmap_activate(keep);
+    assert(*ptr == -1);
+    pmap_activate(pmap);
+    assert(*ptr == i);
+    pmap_activate(NULL);
+    pmap_delete(pmap);
+  }
+
+  pmap_activate(keep);
+  assert(*ptr == -1);
+  pmap_activate(NULL);
+  pmap_delete(keep);
+
+  pm_free(pg);
+  pm_free(keep_pg);
+
+  /* Restore original user pmap */
+  pmap_activate(orig);
+
+  return KTEST_SUCCESS;
+}
+
+/* Page tables of destroyed pmap are reused, once prepared by idle thread. */
+static int test_pt_cache_pmap(void) {
+  pmap_stats_t before, after;
+  vaddr_t start = 0x1001000;
+  vm_page_t *pg = pm_alloc(1);
+
+  pmap_t *pmap = pmap_new();
+  pmap_enter(pmap, start, pg, VM_PROT_READ | VM_PROT_WRITE);
+  pmap_delete(pmap);
+
+  pmap_stats(&before);
+  assert(before.pt_cache_ready + before.pt_cache_dirty > 0);
+
+  /* Do the work of idle thread, until all cached page tables are ready. */
+  do {
+    pmap_idle();
+    pmap_stats(&before);
+  } while (before.pt_cache_dirty > 0);
+
+  pmap = pmap_new();
+  pmap_enter(pmap, start, pg, VM_PROT_READ | VM_PROT_WRITE);
+  pmap_stats(&after);
+  assert(after.pt_cache_hits == before.pt_cache_hits + 1);
+  assert(after.pt_cache_ready == before.pt_cache_ready - 1);
+
+  /* Page table emptied by pmap_remove needs no clearing by idle thread. */
+  pmap_remove(pmap, start, start + PAGESIZE);
+  pmap_stats(&after);
+  assert(after.pt_cache_ready == before.pt_cache_ready);
+  assert(after.pt_cache_dirty == 0);
+
+  pmap_delete(pmap);
+  pm_free(pg);
+
+  kprintf("page table cache: %u hits, %u misses\n", after.pt_cache_hits,
+          after.pt_cache_misses);
+
+  return KTEST_SUCCESS;
+}
+
+#define BENCH_ROUNDS 64
+
+/* Reports average number of C0_COUNT ticks (half of CPU clock on most MIPS32
+ * cores) spent zeroing and copying a page with generic string routines and
+ * with page primitives used by pmap. */
+static int test_page_bench(void) {
+  vm_page_t *src = pm_alloc(1);
+  vm_page_t *dst = pm_alloc(1);
+  char *src_p = PG_KSEG0_ADDR(src);
+  char *dst_p = PG_KSEG0_ADDR(dst);
+  uint32_t start, bzero_ticks, zero_ticks, memcpy_ticks, copy_ticks;
+
+  memset(dst_p, -1, PAGESIZE);
+  start = mips32_getcount();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+    bzero(dst_p, PAGESIZE);
+  bzero_ticks = mips32_getcount() - start;
+
+  memset(dst_p, -1, PAGESIZE);
+  start = mips32_getcount();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+    pmap_zero_page(dst);
+  zero_ticks = mips32_getcount() - start;
+
+  for (int i = 0; i < PAGESIZE; i++)
+    assert(dst_p[i] == 0);
+
+  for (int i = 0; i < PAGESIZE; i++)
+    src_p[i] = i * 7;
+
+  start = mips32_getcount();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+    memcpy(dst_p, src_p, PAGESIZE);
+  memcpy_ticks = mips32_getcount() - start;
+
+  bzero(dst_p, PAGESIZE);
+  start = mips32_getcount();
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+    pmap_copy_page(src, dst);
+  copy_ticks = mips32_getcount() - start;
+
+  for (int i = 0; i < PAGESIZE; i++)
+    assert(dst_p[i] == src_p[i]);
+
+  kprintf("zero page: bzero %u, pmap_zero_page %u ticks per page\n",
+          bzero_ticks / BENCH_ROUNDS, zero_ticks / BENCH_ROUNDS);
+  kprintf("copy page: memcpy %u, pmap_copy_page %u ticks per page\n",
+          memcpy_ticks / BENCH_ROUNDS, copy_ticks / BENCH_ROUNDS);
+
+  pm_free(src);
+  pm_free(dst);
+
+  return KTEST_SUCCESS;
+}
+
 KTEST_ADD(pmap_kernel, test_kernel_pmap, 0);
+KTEST_ADD(pmap_large, test_large_pmap, 0);
 KTEST_ADD(pmap_user, test_user_pmap, 0);
+KTEST_ADD(pmap_remove, test_remove_pmap, 0);
+KTEST_ADD(pmap_asid, test_asid_pmap, 0);
+KTEST_ADD(pmap_pt_cache, test_pt_cache_pmap, 0);
+KTEST_ADD(pmap_page_bench, test_page_bench, 0);
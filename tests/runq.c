@@ -0,0 +1,33 @@
+#include <ktest.h>
+#include <stdc.h>
+#include <thread.h>
+#include <runq.h>
+
+/* Run queue keeps track of number of threads, which is used by scheduler to
+ * balance load between processors. */
+static int test_runq_count(void) {
+  static runq_t rq;
+  static thread_t threads[RQ_NQS];
+
+  runq_init(&rq);
+  assert(runq_empty(&rq));
+
+  for (int i = 0; i < RQ_NQS; i++) {
+    threads[i].td_prio = (RQ_NQS - 1 - i) * RQ_PPQ;
+    runq_add(&rq, &threads[i]);
+    assert(rq.rq_count == i + 1U);
+  }
+
+  for (int i = 0; i < RQ_NQS; i++) {
+    assert(!runq_empty(&rq));
+    thread_t *td = runq_choose(&rq);
+    assert(td->td_prio == (RQ_NQS - 1 - i) * RQ_PPQ);
+    runq_remove(&rq, td);
+    assert(rq.rq_count == RQ_NQS - 1U - i);
+  }
+
+  assert(runq_empty(&rq));
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(runq_count, test_runq_count, 0);
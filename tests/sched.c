@@ -2,6 +2,9 @@
 #include <time.h>
 #include <thread.h>
 #include <sched.h>
+#include <sleepq.h>
+#include <spinlock.h>
+#include <proc.h>
 #include <vm_map.h>
 #include <vm_pager.h>
 #include <ktest.h>
@@ -94,3 +97,66 @@ static int test_sched(void) {
 
 KTEST_ADD(sched, test_sched, KTEST_FLAG_NORETURN);
 #endif
+
+/* Interactivity is tracked only for threads that belong to a process. */
+static proc_t interact_proc;
+static thread_t *sleeper, *spinner;
+static int interact_chan;
+static volatile bool interact_done;
+static prio_t sleeper_prio, spinner_prio;
+
+#define INTERACT_TEST_MS 200
+
+static void sleeper_routine(void *arg) {
+  while (!interact_done)
+    sleepq_wait(&interact_chan, "interactivity test");
+}
+
+/* Keeps running, but wakes up the sleeper on each clock tick. */
+static void spinner_routine(void *arg) {
+  systime_t last = getsystime();
+  systime_t end = last + INTERACT_TEST_MS;
+
+  for (systime_t now = last; now < end; now = getsystime()) {
+    if (now != last) {
+      sleepq_signal(&interact_chan);
+      last = now;
+    }
+  }
+
+  sleeper_prio = sleeper->td_prio;
+  spinner_prio = thread_self()->td_prio;
+  interact_done = true;
+}
+
+/* Thread that mostly sleeps should end up with higher priority than one that
+ * never does, but not with higher priority than kernel threads. */
+static int test_sched_interactivity(void) {
+  interact_done = false;
+  sleeper = thread_create("sleeper", sleeper_routine, NULL);
+  spinner = thread_create("spinner", spinner_routine, NULL);
+
+  thread_t *threads[] = {sleeper, spinner};
+  for (int i = 0; i < 2; i++) {
+    WITH_MTX_LOCK (&threads[i]->td_lock)
+      threads[i]->td_proc = &interact_proc;
+    WITH_SPINLOCK(threads[i]->td_spin) {
+      sched_set_prio(threads[i], 0);
+    }
+    sched_add(threads[i]);
+  }
+
+  thread_join(spinner);
+  /* Sleeper might have missed the last wakeup. */
+  while (!td_is_dead(sleeper)) {
+    sleepq_signal(&interact_chan);
+    thread_yield();
+  }
+  thread_join(sleeper);
+
+  assert(sleeper_prio > spinner_prio);
+  assert(sleeper_prio <= PRIO_USER_MAX);
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(sched_interactivity, test_sched_interactivity, 0);
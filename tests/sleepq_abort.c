@@ -89,7 +89,7 @@ static int test_sleepq_abort_mult(void) {
 
   for (int i = 0; i < T; i++) {
     WITH_SPINLOCK(waiters[i]->td_spin) {
-      sched_set_prio(waiters[i], RQ_PPQ);
+      sched_set_prio(waiters[i], PRIO_KTHREAD + RQ_PPQ);
     }
   }
 
@@ -116,7 +116,7 @@ static int test_sleepq_abort_simple(void) {
   waker = thread_create("simp-waker", simple_waker_routine, NULL);
 
   WITH_SPINLOCK(waiters[0]->td_spin) {
-    sched_set_prio(waiters[0], RQ_PPQ);
+    sched_set_prio(waiters[0], PRIO_KTHREAD + RQ_PPQ);
   }
 
   sched_add(waiters[0]);
@@ -0,0 +1,54 @@
+#define KL_LOG KL_TEST
+#include <klog.h>
+#include <ktest.h>
+#include <swap.h>
+#include <vm_map.h>
+#include <vm_object.h>
+
+#define NPAGES 32
+
+static int test_swap(void) {
+  if (swap_available() < NPAGES) {
+    klog("Not enough swap space, pass 'swapsize' argument to the kernel!");
+    return KTEST_SUCCESS;
+  }
+
+  vm_map_t *orig = get_user_vm_map();
+  vm_map_t *umap = vm_map_new();
+  vm_map_activate(umap);
+
+  vaddr_t start = 0x1000000;
+  vaddr_t end = start + NPAGES * PAGESIZE;
+
+  vm_object_t *obj = vm_object_alloc(VM_ANONYMOUS);
+  vm_segment_t *seg =
+    vm_segment_alloc(obj, start, end, VM_PROT_READ | VM_PROT_WRITE);
+  assert(vm_map_insert(umap, seg, VM_FIXED) == 0);
+
+  for (unsigned *ptr = (unsigned *)start; ptr != (unsigned *)end; ptr++)
+    *ptr = (vaddr_t)ptr ^ 0xfeedbabe;
+
+  /* Other address spaces may be visited first. */
+  size_t avail = swap_available();
+  for (int i = 0; i < 16 && obj->npages > 0; i++)
+    vm_map_pageout(NPAGES);
+  assert(obj->npages == 0);
+  assert(swap_available() <= avail - NPAGES);
+
+  uint8_t vec[NPAGES];
+  assert(vm_map_resident(umap, start, end, vec) == 0);
+  for (int i = 0; i < NPAGES; i++)
+    assert(vec[i] == 0);
+
+  /* Touching pages brings their contents back from swap. */
+  for (unsigned *ptr = (unsigned *)start; ptr != (unsigned *)end; ptr++)
+    assert(*ptr == ((vaddr_t)ptr ^ 0xfeedbabe));
+  assert(obj->npages == NPAGES);
+
+  vm_map_activate(orig);
+  vm_map_delete(umap);
+
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(swap, test_swap, 0);
@@ -50,4 +50,31 @@ static int test_thread_join(void) {
   return KTEST_SUCCESS;
 }
 
+static void test_thread_nop(void *p) {
+}
+
+/* Reaped thread is recycled with its resources by next thread_create. */
+static int test_thread_cache(void) {
+  thread_t *t1 = thread_create("test-thread-1", test_thread_nop, NULL);
+  void *kstack = t1->td_kstack.stk_base;
+  tid_t t1_id = t1->td_tid;
+
+  sched_add(t1);
+  thread_join(t1);
+  thread_reap();
+
+  thread_t *t2 = thread_create("test-thread-2", test_thread_nop, NULL);
+  assert(t2 == t1);
+  assert(t2->td_kstack.stk_base == kstack);
+  assert(t2->td_tid != t1_id);
+  assert(t2->td_state == TDS_INACTIVE);
+  assert(strcmp(t2->td_name, "test-thread-2") == 0);
+
+  sched_add(t2);
+  thread_join(t2);
+
+  return KTEST_SUCCESS;
+}
+
 KTEST_ADD(thread_join, test_thread_join, 0);
+KTEST_ADD(thread_cache, test_thread_cache, 0);
@@ -28,10 +28,12 @@ static int test_thread_stats_nop(void) {
   }
   for (int i = 0; i < THREADS_NUMBER; i++) {
     thread_t *td = threads[i];
+    timeval_t rtime = cputicks2tv(td->td_rtime);
+    timeval_t slptime = cputicks2tv(td->td_slptime);
     klog("Thread:%d runtime:%u.%u sleeptime:%u.%u context switches:%llu", i,
-         td->td_rtime.tv_sec, td->td_rtime.tv_usec, td->td_slptime.tv_sec,
-         td->td_slptime.tv_usec, td->td_nctxsw);
-    if (!timeval_isset(&td->td_rtime) && timeval_isset(&td->td_slptime))
+         rtime.tv_sec, rtime.tv_usec, slptime.tv_sec, slptime.tv_usec,
+         td->td_nctxsw);
+    if (!td->td_rtime && td->td_slptime)
       return KTEST_FAILURE;
   }
 
@@ -73,16 +75,52 @@ static int test_thread_stats_slp(void) {
   thread_join(waker);
   for (int i = 0; i < THREADS_NUMBER; i++) {
     thread_t *td = threads[i];
+    timeval_t rtime = cputicks2tv(td->td_rtime);
+    timeval_t slptime = cputicks2tv(td->td_slptime);
     klog("Thread: %d, runtime: %u.%u, sleeptime: %u.%u, context switches: %llu",
-         i, td->td_rtime.tv_sec, td->td_rtime.tv_usec, td->td_slptime.tv_sec,
-         td->td_slptime.tv_usec, td->td_nctxsw);
-    if (!timeval_isset(&td->td_rtime) || !timeval_isset(&td->td_slptime))
+         i, rtime.tv_sec, rtime.tv_usec, slptime.tv_sec, slptime.tv_usec,
+         td->td_nctxsw);
+    if (!td->td_rtime || !td->td_slptime)
       return KTEST_FAILURE;
   }
   return KTEST_SUCCESS;
 }
 
+static void thread_exit_function(void *arg) {
+}
+
+/* Every thread added to the scheduler is dispatched after its wakeup, so it
+ * must show up in latency histograms. */
+static int test_sched_latency(void) {
+  thread_t *threads[THREADS_NUMBER];
+  sched_lat_band_t bands[SCHED_LAT_BANDS];
+
+  sched_lat_reset();
+  for (int i = 0; i < THREADS_NUMBER; i++) {
+    threads[i] = thread_create("exit thread", thread_exit_function, NULL);
+    sched_add(threads[i]);
+  }
+  for (int i = 0; i < THREADS_NUMBER; i++)
+    thread_join(threads[i]);
+  sched_lat_get(bands);
+
+  unsigned count = 0;
+  for (int i = 0; i < SCHED_LAT_BANDS; i++) {
+    unsigned nsamples = 0;
+    for (int j = 0; j < SCHED_LAT_BUCKETS; j++)
+      nsamples += bands[i].latency[j];
+    assert(nsamples == bands[i].count);
+    count += bands[i].count;
+  }
+  klog("Collected %d wakeup-to-run latency samples", count);
+  if (count < THREADS_NUMBER)
+    return KTEST_FAILURE;
+
+  return KTEST_SUCCESS;
+}
+
 /* TODO: These tests take too long to run to be a part of regular test run.
  * For now we have to run them manually. */
 KTEST_ADD(thread_stats_nop, test_thread_stats_nop, KTEST_FLAG_BROKEN);
 KTEST_ADD(thread_stats_slp, test_thread_stats_slp, KTEST_FLAG_BROKEN);
+KTEST_ADD(sched_latency, test_sched_latency, 0);
@@ -14,8 +14,10 @@
 
 typedef TAILQ_HEAD(td_queue, thread) td_queue_t;
 
-static prio_t starting_priority = 2;
-static prio_t new_priorities[T] = {2, 1, 3, 0, 1};
+static prio_t starting_priority = PRIO_KTHREAD + 2;
+static prio_t new_priorities[T] = {PRIO_KTHREAD + 2, PRIO_KTHREAD + 1,
+                                   PRIO_KTHREAD + 3, PRIO_KTHREAD,
+                                   PRIO_KTHREAD + 1};
 
 static mtx_t ts_adj_mtx = MTX_INITIALIZER(MTX_DEF);
 static volatile int stopped;
@@ -27,7 +27,7 @@ static void set_prio(thread_t *td, prio_t prio) {
 
 /* n <- [0..T] */
 static int propagator_prio(int n) {
-  return n * RQ_PPQ;
+  return PRIO_KTHREAD + n * RQ_PPQ;
 }
 
 static bool td_is_blocked_on_mtx(thread_t *td, mtx_t *m) {
@@ -37,9 +37,9 @@ static void unlend_prio(thread_t *td, prio_t prio) {
 enum {
   /* Priorities are multiplies of RunQueue_PriorityPerQueue
    * so that each priority matches different run queue. */
-  LOW = 0,
-  MED = RQ_PPQ,
-  HIGH = 2 * RQ_PPQ
+  LOW = PRIO_KTHREAD,
+  MED = PRIO_KTHREAD + RQ_PPQ,
+  HIGH = PRIO_KTHREAD + 2 * RQ_PPQ
 };
 
 /* code executed by td0 */
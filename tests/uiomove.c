@@ -1,7 +1,9 @@
 #include <uio.h>
+#include <errno.h>
 #include <systm.h>
 #include <stdc.h>
 #include <vm_map.h>
+#include <vm_object.h>
 #include <ktest.h>
 
 static int test_uiomove(void) {
@@ -60,4 +62,49 @@ static int test_uiomove(void) {
   return KTEST_SUCCESS;
 }
 
+#define FOREIGN_START 0x1000000
+#define FOREIGN_END 0x1002000
+
+/* Moves data to and from address space that is not active. */
+static int test_uiomove_foreign(void) {
+  vm_map_t *orig = get_user_vm_map();
+  vm_map_t *map = vm_map_new();
+
+  vm_object_t *obj = vm_object_alloc(VM_ANONYMOUS);
+  vm_segment_t *seg = vm_segment_alloc(obj, FOREIGN_START, FOREIGN_END,
+                                       VM_PROT_READ | VM_PROT_WRITE);
+  int res = vm_map_insert(map, seg, VM_FIXED);
+  assert(res == 0);
+
+  const char *text = "Data crossing page boundary of foreign address space.";
+  size_t len = strlen(text) + 1;
+  /* Place the string so that it spans both pages of the segment. */
+  char *uaddr = (char *)FOREIGN_START + PAGESIZE - 16;
+
+  uio_t uio = UIO_SINGLE(UIO_READ, map, 0, uaddr, len);
+  res = uiomove((char *)text, len, &uio);
+  assert(res == 0 && uio.uio_resid == 0);
+
+  char buffer[100];
+  memset(buffer, 0, sizeof(buffer));
+  uio = UIO_SINGLE(UIO_WRITE, map, 0, uaddr, len);
+  res = uiomove(buffer, len, &uio);
+  assert(res == 0);
+  assert(strcmp(buffer, text) == 0);
+
+  /* Data must be visible once the address space becomes active. */
+  vm_map_activate(map);
+  assert(strcmp(uaddr, text) == 0);
+  vm_map_activate(orig);
+
+  /* Addresses outside of any segment must be reported. */
+  uio = UIO_SINGLE(UIO_WRITE, map, 0, (char *)FOREIGN_END, 4);
+  res = uiomove(buffer, 4, &uio);
+  assert(res == -EFAULT);
+
+  vm_map_delete(map);
+  return KTEST_SUCCESS;
+}
+
 KTEST_ADD(uiomove, test_uiomove, 0);
+KTEST_ADD(uiomove_foreign, test_uiomove_foreign, 0);
@@ -7,6 +7,7 @@
 #include <sched.h>
 #include <proc.h>
 #include <wait.h>
+#include <smp.h>
 
 static void utest_generic_thread(void *arg) {
   const char *test_name = arg;
@@ -57,8 +58,11 @@ static int utest_generic(const char *name, int status_success) {
   UTEST_ADD(name, MAKE_STATUS_SIG_TERM(sig), 0)
 
 UTEST_ADD_SIMPLE(mmap);
+UTEST_ADD_SIMPLE(madvise);
 UTEST_ADD_SIMPLE(sbrk);
 UTEST_ADD_SIMPLE(misbehave);
+UTEST_ADD_SIMPLE(stack_grow);
+UTEST_ADD_SIMPLE(stack_limit);
 
 UTEST_ADD_SIMPLE(fd_read);
 UTEST_ADD_SIMPLE(fd_devnull);
@@ -79,6 +83,7 @@ UTEST_ADD_SIMPLE(fork_wait);
 /* TODO Why this test takes so long to execute? */
 /* UTEST_ADD_SIMPLE(fork_signal); */
 /* XXX UTEST_ADD_SIMPLE(fork_sigchld_ignored); */
+UTEST_ADD_SIMPLE(fork_many);
 
 UTEST_ADD_SIMPLE(lseek_basic);
 UTEST_ADD_SIMPLE(lseek_errors);
@@ -88,6 +93,18 @@ UTEST_ADD_SIMPLE(access_basic);
 UTEST_ADD_SIMPLE(stat);
 UTEST_ADD_SIMPLE(fstat);
 
+/* Spreading work across processors can only be checked on SMP machines. */
+static int utest_test_smp_spread(void) {
+  if (ncpus == 1) {
+    kprintf("Skipping user test smp_spread: single processor machine.\n");
+    return KTEST_SUCCESS;
+  }
+  return utest_generic("smp_spread", MAKE_STATUS_EXIT(0));
+}
+
+KTEST_ADD(user_smp_spread, utest_test_smp_spread, KTEST_FLAG_USERMODE);
+UTEST_ADD_SIMPLE(sched_policy);
+
 #if 0
 UTEST_ADD_SIMPLE(fpu_fcsr);
 UTEST_ADD_SIMPLE(fpu_gpr_preservation);
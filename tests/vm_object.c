@@ -0,0 +1,58 @@
+#include <ktest.h>
+#include <physmem.h>
+#include <vm_object.h>
+
+#define NPAGES 64
+
+/* Spreads pages sparsely, so that the trie grows several levels. */
+static off_t page_offset(int i) {
+  return (off_t)(i * i * 37) * PAGESIZE;
+}
+
+static int test_vm_object_pages(void) {
+  vm_object_t *obj = vm_object_alloc(VM_DUMMY);
+
+  for (int i = 0; i < NPAGES; i++)
+    assert(vm_object_add_page(obj, page_offset(i), pm_alloc(1)));
+  assert(obj->npages == NPAGES);
+
+  /* Slots are not allowed to be reused. */
+  vm_page_t *pg = pm_alloc(1);
+  assert(!vm_object_add_page(obj, page_offset(7), pg));
+  pm_free(pg);
+
+  for (int i = 0; i < NPAGES; i++) {
+    pg = vm_object_find_page(obj, page_offset(i));
+    assert(pg != NULL && pg->offset == page_offset(i) && pg->object == obj);
+    if (i > 0)
+      assert(vm_object_find_page(obj, page_offset(i) - PAGESIZE) == NULL);
+  }
+
+  assert(!vm_object_range_empty(obj, 0, PAGESIZE));
+  assert(vm_object_range_empty(obj, page_offset(10) + PAGESIZE,
+                               page_offset(11)));
+  assert(!vm_object_range_empty(obj, page_offset(10) + PAGESIZE,
+                                page_offset(11) + PAGESIZE));
+
+  /* Remove every page in [page_offset(8), page_offset(16)). */
+  vm_object_remove_range(obj, page_offset(8), page_offset(16));
+  assert(obj->npages == NPAGES - 8);
+  assert(vm_object_range_empty(obj, page_offset(8), page_offset(16)));
+  assert(vm_object_find_page(obj, page_offset(16)) != NULL);
+
+  /* Move pages from page_offset(32) on into another object. */
+  vm_object_t *tail = vm_object_split(obj, page_offset(32));
+  assert(obj->npages == 24 && tail->npages == 32);
+  assert(vm_object_range_empty(obj, page_offset(32), page_offset(NPAGES)));
+  for (int i = 32; i < NPAGES; i++) {
+    pg = vm_object_find_page(tail, page_offset(i) - page_offset(32));
+    assert(pg != NULL && pg->object == tail);
+  }
+
+  vm_object_free(tail);
+  vm_object_free(obj);
+
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(vm_object, test_vm_object_pages, 0);
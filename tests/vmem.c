@@ -0,0 +1,86 @@
+#include <ktest.h>
+#include <errno.h>
+#include <kva.h>
+#include <physmem.h>
+#include <vmem.h>
+
+#define SPAN_START 0x10000
+#define SPAN_SIZE 0x100000
+#define NRANGES 64
+
+static vmem_t test_arena;
+
+static vmem_size_t range_size(int i) {
+  return (1 + (i * 7) % 5) * PAGESIZE;
+}
+
+static int test_vmem(void) {
+  vmem_t *vm = &test_arena;
+  vmem_addr_t addr[NRANGES];
+
+  vmem_init(vm, "test", PAGESIZE, 0);
+  assert(vmem_add(vm, SPAN_START, SPAN_SIZE) == 0);
+
+  for (int i = 0; i < NRANGES; i++) {
+    vmem_size_t size = range_size(i);
+    assert(vmem_alloc(vm, size, &addr[i]) == 0);
+    assert(addr[i] >= SPAN_START && addr[i] + size <= SPAN_START + SPAN_SIZE);
+    for (int j = 0; j < i; j++)
+      assert(addr[i] + size <= addr[j] || addr[j] + range_size(j) <= addr[i]);
+  }
+
+  /* Release in scattered order to exercise coalescing on both sides. */
+  for (int i = 0; i < NRANGES; i++) {
+    int j = (i * 13) % NRANGES;
+    vmem_free(vm, addr[j], range_size(j));
+  }
+
+  /* Whole span must be available again as a single range. */
+  vmem_addr_t start;
+  assert(vmem_alloc(vm, SPAN_SIZE, &start) == 0 && start == SPAN_START);
+  assert(vmem_alloc(vm, PAGESIZE, &start) == -ENOMEM);
+  vmem_free(vm, SPAN_START, SPAN_SIZE);
+
+  vmem_destroy(vm);
+  return KTEST_SUCCESS;
+}
+
+static int test_vmem_qcache(void) {
+  vmem_t *vm = &test_arena;
+  vmem_addr_t addr[NRANGES];
+
+  vmem_init(vm, "test-qcache", PAGESIZE, 2 * PAGESIZE);
+  assert(vmem_add(vm, SPAN_START, SPAN_SIZE) == 0);
+
+  /* Ranges freed into quantum cache are handed out again first. */
+  for (int i = 0; i < NRANGES; i++)
+    assert(vmem_alloc(vm, PAGESIZE, &addr[i]) == 0);
+  vmem_free(vm, addr[0], PAGESIZE);
+  vmem_addr_t again;
+  assert(vmem_alloc(vm, PAGESIZE, &again) == 0 && again == addr[0]);
+
+  for (int i = 0; i < NRANGES; i++)
+    vmem_free(vm, addr[i], PAGESIZE);
+
+  vmem_destroy(vm);
+  return KTEST_SUCCESS;
+}
+
+static int test_kva_map(void) {
+  vm_page_t *pg = pm_alloc_high(4);
+  unsigned *array = kva_map_page(pg);
+  assert(array != NULL);
+
+  for (unsigned i = 0; i < PG_SIZE(pg) / sizeof(unsigned); i++)
+    array[i] = i;
+  for (unsigned i = 0; i < PG_SIZE(pg) / sizeof(unsigned); i++)
+    assert(array[i] == i);
+
+  kva_unmap_page(array, pg);
+  pm_free(pg);
+  return KTEST_SUCCESS;
+}
+
+KTEST_ADD(vmem, test_vmem, 0);
+KTEST_ADD(vmem_qcache, test_vmem_qcache, 0);
+KTEST_ADD(kva_map, test_kva_map, 0);
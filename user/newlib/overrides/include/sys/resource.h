@@ -0,0 +1 @@
+../../../../../include/resource.h
\ No newline at end of file
@@ -60,3 +60,33 @@ int test_fork_sigchld_ignored(void) {
      SIGCHILD. */
   return 0;
 }
+
+#define NCHILDREN 80
+
+/* Zombie children keep their PIDs, so all of them exist at the same time. */
+int test_fork_many(void) {
+  pid_t pids[NCHILDREN];
+
+  for (int i = 0; i < NCHILDREN; i++) {
+    pids[i] = fork();
+    assert(pids[i] >= 0);
+    if (pids[i] == 0)
+      exit(i);
+  }
+
+  for (int i = 0; i < NCHILDREN; i++) {
+    int status;
+    assert(waitpid(pids[i], &status, 0) == pids[i]);
+    assert(WIFEXITED(status));
+    assert(WEXITSTATUS(status) == i);
+  }
+
+  /* PID of a reaped process must not be given out right away. */
+  pid_t pid = fork();
+  if (pid == 0)
+    exit(0);
+  for (int i = 0; i < NCHILDREN; i++)
+    assert(pid != pids[i]);
+  assert(waitpid(pid, NULL, 0) == pid);
+  return 0;
+}
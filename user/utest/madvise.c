@@ -0,0 +1,102 @@
+#include "utest.h"
+
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#define PGSZ 0x1000
+#define NPAGES 64
+
+/* Returns number of resident pages in given range. */
+static int resident(char *addr, size_t npages) {
+  char vec[NPAGES];
+  assert(npages <= NPAGES);
+  assert(mincore(addr, npages * PGSZ, vec) == 0);
+  int n = 0;
+  for (size_t i = 0; i < npages; i++)
+    n += vec[i];
+  return n;
+}
+
+static long faults(void) {
+  struct rusage ru;
+  assert(getrusage(RUSAGE_SELF, &ru) == 0);
+  return ru.ru_minflt;
+}
+
+static void madvise_willneed(void) {
+  char *addr = mmap(NULL, NPAGES * PGSZ, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  assert(resident(addr, NPAGES) == 0);
+
+  assert(madvise(addr, NPAGES * PGSZ, MADV_WILLNEED) == 0);
+  assert(resident(addr, NPAGES) == NPAGES);
+
+  /* Whole range was brought in, so touching it must not fault. */
+  long before = faults();
+  for (int i = 0; i < NPAGES; i++) {
+    assert(addr[i * PGSZ] == 0);
+    addr[i * PGSZ] = 1;
+  }
+  assert(faults() == before);
+
+  assert(munmap(addr, NPAGES * PGSZ) == 0);
+}
+
+static void madvise_dontneed(void) {
+  char *addr = mmap(NULL, NPAGES * PGSZ, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  memset(addr, -1, NPAGES * PGSZ);
+  assert(resident(addr, NPAGES) == NPAGES);
+
+  /* Drop the first half of the range. */
+  assert(madvise(addr, NPAGES / 2 * PGSZ, MADV_DONTNEED) == 0);
+  assert(resident(addr, NPAGES) == NPAGES / 2);
+
+  /* Mapping stays, discarded pages come back cleared. */
+  for (int i = 0; i < NPAGES; i++)
+    assert(addr[i * PGSZ] == (i < NPAGES / 2 ? 0 : -1));
+
+  assert(munmap(addr, NPAGES * PGSZ) == 0);
+}
+
+static void madvise_sequential(void) {
+  char *addr = mmap(NULL, NPAGES * PGSZ, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  assert(madvise(addr, NPAGES * PGSZ, MADV_SEQUENTIAL) == 0);
+
+  /* Fault-around must save us from taking a fault for every page. */
+  long before = faults();
+  for (int i = 0; i < NPAGES; i++)
+    addr[i * PGSZ] = 1;
+  assert(faults() - before <= NPAGES / 8);
+  assert(resident(addr, NPAGES) == NPAGES);
+
+  assert(munmap(addr, NPAGES * PGSZ) == 0);
+}
+
+static void madvise_bad(void) {
+  char *addr = mmap(NULL, PGSZ, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  /* Unknown advice. */
+  assert(madvise(addr, PGSZ, 1234) == -1);
+  assert(errno == EINVAL);
+  /* Address is not page aligned. */
+  assert(madvise(addr + 1, PGSZ, MADV_WILLNEED) == -1);
+  assert(errno == EINVAL);
+  /* Residency of unmapped range cannot be reported. */
+  assert(munmap(addr, PGSZ) == 0);
+  char vec[1];
+  assert(mincore(addr, PGSZ, vec) == -1);
+  assert(errno == ENOMEM);
+}
+
+int test_madvise(void) {
+  madvise_willneed();
+  madvise_dontneed();
+  madvise_sequential();
+  madvise_bad();
+  return 0;
+}
@@ -18,8 +18,11 @@ int main(int argc, char **argv) {
   /* Linker set in userspace would be quite difficult to set up, and it feels
      like an overkill to me. */
   CHECKRUN_TEST(mmap);
+  CHECKRUN_TEST(madvise);
   CHECKRUN_TEST(sbrk);
   CHECKRUN_TEST(misbehave);
+  CHECKRUN_TEST(stack_grow);
+  CHECKRUN_TEST(stack_limit);
   CHECKRUN_TEST(fd_read);
   CHECKRUN_TEST(fd_devnull);
   CHECKRUN_TEST(fd_multidesc);
@@ -36,11 +39,14 @@ int main(int argc, char **argv) {
   CHECKRUN_TEST(fork_wait);
   CHECKRUN_TEST(fork_signal);
   CHECKRUN_TEST(fork_sigchld_ignored);
+  CHECKRUN_TEST(fork_many);
   CHECKRUN_TEST(lseek_basic);
   CHECKRUN_TEST(lseek_errors);
   CHECKRUN_TEST(access_basic);
   CHECKRUN_TEST(stat);
   CHECKRUN_TEST(fstat);
+  CHECKRUN_TEST(smp_spread);
+  CHECKRUN_TEST(sched_policy);
   CHECKRUN_TEST(exc_cop_unusable);
   CHECKRUN_TEST(exc_reserved_instruction);
   CHECKRUN_TEST(exc_integer_overflow);
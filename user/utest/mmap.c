@@ -4,7 +4,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/signal.h>
 
 static void mmap_no_hint(void) {
   void *addr = mmap(NULL, 12345, PROT_READ | PROT_WRITE, MAP_ANON);
@@ -48,9 +53,81 @@ static void mmap_bad(void) {
   assert(errno == EINVAL);
 }
 
+#define TESTADDR (void *)0x23456000
+static void munmap_good(void) {
+  char *addr = mmap(TESTADDR, 4 * 0x1000, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  memset(addr, -1, 4 * 0x1000);
+  /* Punch a hole in the middle of the mapping. */
+  assert(munmap(addr + 0x1000, 0x1000) == 0);
+  /* Pages around the hole must be left intact. */
+  assert(addr[0] == -1 && addr[0x2000] == -1 && addr[0x3fff] == -1);
+  /* The hole can be mapped again and is backed by a fresh page. */
+  char *hole =
+    mmap(addr + 0x1000, 0x1000, PROT_READ | PROT_WRITE, MAP_ANON | MAP_FIXED);
+  assert(hole == addr + 0x1000);
+  assert(hole[0] == 0);
+  /* Unmapping a range that spans many segments and gaps is fine. */
+  assert(munmap(addr, 8 * 0x1000) == 0);
+  /* Whole range is free again. */
+  char *again = mmap(addr, 4 * 0x1000, PROT_READ, MAP_ANON | MAP_FIXED);
+  assert(again == addr);
+  assert(munmap(again, 4 * 0x1000) == 0);
+}
+#undef TESTADDR
+
+static void munmap_bad(void) {
+  /* Address is not page aligned. */
+  assert(munmap((void *)0x12345678, 0x1000) == -1);
+  assert(errno == EINVAL);
+  /* Zero length. */
+  assert(munmap((void *)0x12345000, 0) == -1);
+  assert(errno == EINVAL);
+  /* Address range spans user and kernel space. */
+  assert(munmap((void *)0x7fff0000, 0x20000) == -1);
+  assert(errno == EINVAL);
+  /* Address range lies within the brk segment. */
+  char *brk = sbrk(0x2000);
+  char *page = (char *)(((uintptr_t)brk + 0xfff) & ~0xfff);
+  assert(munmap(page, 0x1000) == -1);
+  assert(errno == EINVAL);
+  sbrk(-0x2000);
+}
+
+static void mprotect_good(void) {
+  char *addr = mmap(NULL, 2 * 0x1000, PROT_READ | PROT_WRITE, MAP_ANON);
+  assert(addr != MAP_FAILED);
+  memset(addr, 42, 2 * 0x1000);
+
+  assert(mprotect(addr, 0x1000, PROT_READ) == 0);
+  /* Data survives protection change. */
+  assert(addr[0] == 42 && addr[0x1000] == 42);
+  /* Second page remains writable. */
+  addr[0x1000] = 13;
+
+  int pid = fork();
+  if (pid == 0) {
+    /* Writing to read-only page must kill the child. */
+    addr[0] = 0;
+    exit(0);
+  }
+
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+
+  assert(mprotect(addr, 0x1000, PROT_READ | PROT_WRITE) == 0);
+  addr[0] = 7;
+  assert(addr[0] == 7 && addr[0x1000] == 13);
+  assert(munmap(addr, 2 * 0x1000) == 0);
+}
+
 int test_mmap() {
   mmap_no_hint();
   mmap_with_hint();
   mmap_bad();
+  munmap_good();
+  munmap_bad();
+  mprotect_good();
   return 0;
 }
@@ -32,18 +32,22 @@ static void sbrk_bad(void) {
   /* Attempt to move sbrk before original start. */
   sbrk(sbrk_orig - sbrk_now - 0x10000);
   assert(errno == EINVAL);
-#if 0
+}
+
+static void sbrk_shrink(void) {
+  char *a1 = sbrk(0);
+  char *a2 = sbrk(0x5000);
+  assert(a2 == a1);
+  memset(a2, -1, 0x5000);
   /* Now, try shrinking data. */
-  sbrk(-1 * (0x5000 + 50 + 40 + 10));
+  sbrk(-0x5000);
   /* Get new brk end */
-  char *a5 = sbrk(0);
-  assert(a1 == a5);
-#else
-  /* Note: sbrk shrinking not yet implemented! */
-  sbrk(4096);
-  sbrk(-4096);
-  assert(errno == ENOTSUP);
-#endif
+  char *a3 = sbrk(0);
+  assert(a1 == a3);
+  /* Memory given back must come back cleared. */
+  char *a4 = sbrk(0x5000);
+  assert(a4 == a1);
+  assert(a4[0x4fff] == 0);
 }
 
 int test_sbrk() {
@@ -52,5 +56,6 @@ int test_sbrk() {
 
   sbrk_bad();
   sbrk_good();
+  sbrk_shrink();
   return 0;
 }
@@ -0,0 +1,51 @@
+#include "utest.h"
+
+#include <errno.h>
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+/* Newlib declares these only for targets that claim priority scheduling. */
+int sched_setscheduler(pid_t pid, int policy, const struct sched_param *param);
+int sched_getscheduler(pid_t pid);
+
+static void sched_set(int policy, int priority) {
+  struct sched_param param = {.sched_priority = priority};
+  assert(sched_setscheduler(0, policy, &param) == 0);
+  assert(sched_getscheduler(0) == policy);
+}
+
+static void sched_set_bad(int policy, int priority) {
+  struct sched_param param = {.sched_priority = priority};
+  assert(sched_setscheduler(0, policy, &param) == -1);
+  assert(errno == EINVAL);
+}
+
+int test_sched_policy(void) {
+  assert(sched_getscheduler(0) == SCHED_OTHER);
+
+  sched_set_bad(-1, 0);
+  sched_set_bad(SCHED_OTHER, 1);
+  sched_set_bad(SCHED_FIFO, -1);
+  sched_set_bad(SCHED_RR, 64); /* reserved for kernel threads */
+  sched_set_bad(SCHED_RR, 128);
+  assert(sched_getscheduler(0) == SCHED_OTHER);
+
+  sched_set(SCHED_RR, 63);
+  sched_set(SCHED_FIFO, 10);
+
+  /* Policy is inherited by child processes. */
+  pid_t pid = fork();
+  if (pid == 0)
+    exit(sched_getscheduler(getpid()));
+
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status));
+  assert(WEXITSTATUS(status) == SCHED_FIFO);
+
+  sched_set(SCHED_OTHER, 0);
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sys/wait.h>
+
+#define NWORKERS 4
+#define NCHUNKS 256
+#define CHUNK 4096
+
+/* Processor number and cycle counter are made readable by the kernel. */
+static unsigned read_cpunum(void) {
+  unsigned value;
+  asm volatile(".set push; .set mips32r2;"
+               "rdhwr %0, $0;"
+               ".set pop"
+               : "=r"(value));
+  return value;
+}
+
+static unsigned read_cycles(void) {
+  unsigned value;
+  asm volatile(".set push; .set mips32r2;"
+               "rdhwr %0, $2;"
+               ".set pop"
+               : "=r"(value));
+  return value;
+}
+
+/* Burns CPU time and returns mask of processors it was executed on. */
+static int burn(unsigned nchunks) {
+  volatile unsigned sum = 0;
+  int cpus = 0;
+  for (unsigned i = 0; i < nchunks; i++) {
+    for (unsigned j = 0; j < CHUNK; j++)
+      sum += j;
+    cpus |= 1 << read_cpunum();
+  }
+  return cpus;
+}
+
+/* Runs the job split between given number of processes. */
+static unsigned run_job(int nworkers, int *cpus) {
+  unsigned start = read_cycles();
+
+  for (int i = 0; i < nworkers; i++)
+    if (fork() == 0)
+      exit(burn(NWORKERS * NCHUNKS / nworkers));
+
+  *cpus = 0;
+  for (int i = 0; i < nworkers; i++) {
+    int status;
+    assert(wait(&status) > 0);
+    assert(WIFEXITED(status));
+    *cpus |= WEXITSTATUS(status);
+  }
+
+  return read_cycles() - start;
+}
+
+/* Checks that processes doing work in parallel run on many processors. */
+int test_smp_spread(void) {
+  int cpus;
+  unsigned serial = run_job(1, &cpus);
+  unsigned parallel = run_job(NWORKERS, &cpus);
+
+  int ncpus = __builtin_popcount(cpus);
+  printf("Serial job took %u cycles, parallel job took %u cycles on %d CPUs.\n",
+         serial, parallel, ncpus);
+
+  /* The kernel skips this test on single processor machines. Timing is only
+   * reported, as it depends too much on the load of the host. */
+  assert(ncpus > 1);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#include "utest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/signal.h>
+#include <sys/resource.h>
+
+#define FRAME_SIZE 4096
+
+/* Each call consumes at least FRAME_SIZE bytes of stack. */
+static int recurse(int depth) {
+  volatile char frame[FRAME_SIZE];
+  memset((char *)frame, depth, FRAME_SIZE);
+  if (depth == 0)
+    return frame[0];
+  return recurse(depth - 1) + frame[FRAME_SIZE - 1];
+}
+
+/* Stack grows well beyond the size of old fixed stack segment (8 MiB). */
+int test_stack_grow(void) {
+  int depth = 12 * 1024 * 1024 / FRAME_SIZE;
+  int sum = 0;
+  for (int i = 1; i <= depth; i++)
+    sum += (char)i;
+  assert(recurse(depth) == sum);
+  return 0;
+}
+
+/* Stack must not grow beyond RLIMIT_STACK. */
+int test_stack_limit(void) {
+  struct rlimit rl;
+  assert(getrlimit(RLIMIT_STACK, &rl) == 0);
+  assert(rl.rlim_cur >= 8 * 1024 * 1024);
+
+  /* Soft limit cannot exceed hard limit. */
+  struct rlimit bad = {.rlim_cur = 2, .rlim_max = 1};
+  assert(setrlimit(RLIMIT_STACK, &bad) == -1);
+  assert(errno == EINVAL);
+
+  int pid = fork();
+  if (pid == 0) {
+    rl.rlim_cur = 1024 * 1024;
+    assert(setrlimit(RLIMIT_STACK, &rl) == 0);
+    recurse(2 * 1024 * 1024 / FRAME_SIZE);
+    exit(0);
+  }
+
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+  return 0;
+}
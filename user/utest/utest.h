@@ -8,8 +8,11 @@ void utest_child_exited(int exitcode);
 
 /* List of available tests. */
 int test_mmap(void);
+int test_madvise(void);
 int test_sbrk(void);
 int test_misbehave(void);
+int test_stack_grow(void);
+int test_stack_limit(void);
 
 int test_fd_read(void);
 int test_fd_devnull(void);
@@ -29,6 +32,7 @@ int test_signal_segfault(void);
 int test_fork_wait(void);
 int test_fork_signal(void);
 int test_fork_sigchld_ignored(void);
+int test_fork_many(void);
 
 int test_lseek_basic(void);
 int test_lseek_errors(void);
@@ -50,4 +54,7 @@ int test_exc_sigsys(void);
 int test_exc_unaligned_access(void);
 int test_syscall_in_bds(void);
 
+int test_smp_spread(void);
+int test_sched_policy(void);
+
 #endif /* __UTEST_H__ */